@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "flbwt.hpp"
+
+/*
+ * End to end benchmark of bwt_string on deterministic synthetic corpora.
+ * Results are written as JSON (one object per corpus) to standard output.
+ */
+
+#define BENCH_DEFAULT_SIZE (16 << 20) // bytes per corpus
+#define ZIPF_WORDS 10000              // vocabulary of the Zipf text
+#define VERSION_EDIT_RATE 1000        // one edit per this many bytes between versions
+
+/**
+ * @brief Random DNA (uniform A, C, G, T).
+ */
+static void generate_dna(std::vector<uint8_t> &T, uint64_t n, std::mt19937_64 &rng)
+{
+    static const uint8_t bases[4] = {'A', 'C', 'G', 'T'};
+
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = bases[rng() & 3];
+}
+
+/**
+ * @brief Prefix of the infinite Fibonacci word (a --> ab, b --> a).
+ */
+static void generate_fibonacci(std::vector<uint8_t> &T, uint64_t n, std::mt19937_64 &/*rng*/)
+{
+    std::string previous = "a";
+    std::string current = "ab";
+
+    while (current.size() < n)
+    {
+        std::string next = current + previous;
+        previous.swap(current);
+        current.swap(next);
+    }
+
+    std::copy(current.begin(), current.begin() + n, T.begin());
+}
+
+/**
+ * @brief Uniform random bytes (0..255).
+ */
+static void generate_random(std::vector<uint8_t> &T, uint64_t n, std::mt19937_64 &rng)
+{
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = rng() & 255;
+}
+
+/**
+ * @brief Words drawn from a Zipf distributed vocabulary, separated by spaces.
+ */
+static void generate_zipf(std::vector<uint8_t> &T, uint64_t n, std::mt19937_64 &rng)
+{
+    std::vector<std::string> words(ZIPF_WORDS);
+    std::vector<double> cdf(ZIPF_WORDS);
+    double sum = 0;
+
+    for (uint64_t r = 0; r < ZIPF_WORDS; r++)
+    {
+        uint64_t length = 2 + rng() % 9;
+        for (uint64_t j = 0; j < length; j++)
+            words[r] += (char)('a' + rng() % 26);
+
+        sum += 1.0 / (r + 1);
+        cdf[r] = sum;
+    }
+
+    std::uniform_real_distribution<double> uniform(0, sum);
+    uint64_t i = 0;
+
+    while (i < n)
+    {
+        uint64_t r = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        const std::string &word = words[std::min<uint64_t>(r, ZIPF_WORDS - 1)];
+
+        for (uint64_t j = 0; j < word.size() && i < n; j++)
+            T[i++] = word[j];
+        if (i < n)
+            T[i++] = ' ';
+    }
+}
+
+/**
+ * @brief Versions of one Zipf text, each a copy of the previous one with a few edits.
+ */
+static void generate_versions(std::vector<uint8_t> &T, uint64_t n, std::mt19937_64 &rng)
+{
+    uint64_t version_length = std::max<uint64_t>(n / 64, 1);
+    std::vector<uint8_t> version(version_length);
+    generate_zipf(version, version_length, rng);
+
+    for (uint64_t i = 0; i < n;)
+    {
+        for (uint64_t e = 0; e < version_length / VERSION_EDIT_RATE + 1; e++)
+        {
+            uint64_t p = rng() % version_length;
+
+            if (rng() & 1)
+                version[p] = 'a' + rng() % 26;
+            else
+                version.insert(version.begin() + p, 'a' + rng() % 26);
+        }
+
+        for (uint64_t j = 0; j < version.size() && i < n; j++)
+            T[i++] = version[j];
+    }
+}
+
+struct Corpus
+{
+    const char *name;
+    void (*generate)(std::vector<uint8_t> &, uint64_t, std::mt19937_64 &);
+};
+
+static const Corpus corpora[] = {
+    {"dna", generate_dna},
+    {"fibonacci", generate_fibonacci},
+    {"versions", generate_versions},
+    {"random", generate_random},
+    {"zipf", generate_zipf},
+};
+
+/**
+ * @brief Get the peak resident set size of the process so far.
+ */
+static uint64_t peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief Run bwt_string on the corpus (fastest of the repeats) and print the result as JSON.
+ */
+static void run_corpus(const Corpus &corpus, uint64_t n, unsigned threads, unsigned repeats, bool first)
+{
+    std::vector<uint8_t> T(n + 1);
+    std::mt19937_64 rng(n);
+    corpus.generate(T, n, rng);
+    T[n] = '\0';
+
+    flbwt::Stats best;
+    double best_seconds = 0;
+
+    for (unsigned r = 0; r < repeats; r++)
+    {
+        flbwt::Stats stats;
+        flbwt::BWT_options options;
+        options.threads = threads;
+        options.stats = &stats;
+
+        auto start = std::chrono::steady_clock::now();
+        flbwt::BWT_result *result = flbwt::bwt_string(T.data(), n, false, options);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+        delete[] result->BWT;
+        free(result);
+
+        if (r == 0 || seconds.count() < best_seconds)
+        {
+            best = stats;
+            best_seconds = seconds.count();
+        }
+    }
+
+    std::cout << (first ? "" : ",\n") << "  {\n";
+    std::cout << "    \"corpus\": \"" << corpus.name << "\",\n";
+    std::cout << "    \"bytes\": " << n << ",\n";
+    std::cout << "    \"threads\": " << threads << ",\n";
+    std::cout << "    \"seconds\": " << best_seconds << ",\n";
+    std::cout << "    \"mb_per_second\": " << n / 1e6 / best_seconds << ",\n";
+    std::cout << "    \"peak_rss_kb\": " << peak_rss_kb() << ",\n";
+    std::cout << "    \"peak_heap_bytes\": " << best.get_peak_memory() << ",\n";
+    std::cout << "    \"sa_bits\": " << (int)best.sa_bits << ",\n";
+    std::cout << "    \"substrings\": " << best.num_of_substrings << ",\n";
+    std::cout << "    \"unique_substrings\": " << best.num_of_unique_substrings << ",\n";
+    std::cout << "    \"phases\": {";
+
+    for (int i = 0; i < flbwt::PHASE_WRITE; i++)
+    {
+        flbwt::Phase phase = (flbwt::Phase)i;
+        std::cout << (i == 0 ? "\n" : ",\n") << "      \"" << flbwt::Stats::get_phase_name(phase) << "\": {"
+                  << "\"wall\": " << best.get_wall_time(phase) << ", "
+                  << "\"cpu\": " << best.get_cpu_time(phase) << ", "
+                  << "\"peak_heap_bytes\": " << best.get_peak_memory(phase) << "}";
+    }
+
+    std::cout << "\n    }\n  }";
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t n = BENCH_DEFAULT_SIZE;
+    unsigned threads = 1;
+    unsigned repeats = 1;
+    const char *only = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            n = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeats = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+            only = argv[++i];
+        else
+        {
+            std::cout << "How to use:" << std::endl;
+            std::cout << "    <program_executable> [--size bytes] [--threads n] [--repeat n]"
+                      << " [--corpus dna|fibonacci|versions|random|zipf]" << std::endl;
+            return -1;
+        }
+    }
+
+    if (n < 2 || threads < 1 || repeats < 1)
+    {
+        std::cout << "Size must be at least 2, threads and repeats at least 1" << std::endl;
+        return -1;
+    }
+
+    // peak_rss_kb is the maximum of the process so far, run one corpus per process to isolate it
+    bool first = true;
+    std::cout << "[\n";
+
+    for (const Corpus &corpus : corpora)
+    {
+        if (only != NULL && strcmp(only, corpus.name) != 0)
+            continue;
+
+        run_corpus(corpus, n, threads, repeats, first);
+        first = false;
+    }
+
+    std::cout << "\n]" << std::endl;
+
+    return 0;
+}
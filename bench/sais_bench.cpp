@@ -0,0 +1,61 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include "packed_array.hpp"
+#include "sais.hpp"
+#include "utility.hpp"
+
+/*
+ * Times flbwt::sais on a random string that is much larger than the caches,
+ * which is where the induced sorting passes are bound by memory latency.
+ * Build once with -DFLBWT_PREFETCH=ON and once with OFF to compare.
+ */
+
+int main(int argc, char *argv[])
+{
+    /* check that user has provided correct number of arguments */
+    if (argc > 4) {
+        std::cout << "Wrong number of arguments!" << std::endl;
+        std::cout << "How to use:" << std::endl;
+        std::cout << "    <program_executable> [length] [alphabet_size] [threads]" << std::endl;
+        return -1;
+    }
+
+    uint64_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : (uint64_t)1 << 25;
+    uint64_t k = (argc > 2) ? strtoull(argv[2], NULL, 10) : (uint64_t)1 << 16;
+    unsigned threads = (argc > 3) ? strtoul(argv[3], NULL, 10) : 1;
+
+    if (n < 2 || k < 2) {
+        std::cout << "Length and alphabet size must be at least 2" << std::endl;
+        return -1;
+    }
+
+    /* random string over 1..k-1 ending with the unique minimum 0 (value i at packed index i + 1) */
+    flbwt::PackedArray *T = new flbwt::PackedArray(n + 1, flbwt::position_of_msb(k - 1));
+    std::mt19937_64 rng(n);
+
+    for (uint64_t i = 0; i + 1 < n; i++)
+        T->set_value(i + 1, 1 + rng() % (k - 1));
+    T->set_value(n, 0);
+
+    flbwt::SAStorage64 SA = flbwt::SAStorage64::allocate(n);
+
+    auto start = std::chrono::steady_clock::now();
+    flbwt::sais(T->get_raw_arr_pointer(), T->get_integer_bits(), SA, 0, n, k, threads);
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+#ifdef FLBWT_PREFETCH
+    const char *prefetch = "on";
+#else
+    const char *prefetch = "off";
+#endif
+
+    std::cout << "length " << n << ", alphabet " << k << ", threads " << threads
+              << ", prefetch " << prefetch << ": " << seconds.count() << " s" << std::endl;
+
+    SA.release();
+    delete T;
+
+    return 0;
+}
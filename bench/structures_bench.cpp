@@ -0,0 +1,261 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "hashtable.hpp"
+#include "packed_array.hpp"
+#include "queue.hpp"
+
+/*
+ * Micro-benchmarks of the data structures every byte of the input passes
+ * through. Items per second are reported for every benchmark.
+ */
+
+#define PACKED_LENGTH (1 << 20) // values in the benchmarked packed array
+#define QUEUE_LENGTH (1 << 20)  // values moved through the benchmarked queue
+#define QUEUE_BACKLOG 4096      // values kept in the queue by the churn benchmark
+#define HASH_STRINGS (1 << 16)  // distinct substrings inserted to the hashtable
+#define GROW_STRINGS (1 << 20)  // substrings inserted to the growing hashtable
+
+static uint64_t value_mask(uint8_t bits)
+{
+    return (bits == 64) ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+}
+
+static void packed_array_set_value(benchmark::State &state)
+{
+    uint8_t bits = state.range(0);
+    uint64_t mask = value_mask(bits);
+    flbwt::PackedArray A(PACKED_LENGTH, bits);
+
+    for (auto _ : state)
+    {
+        for (uint64_t i = 0; i < PACKED_LENGTH; i++)
+            A.set_value(i, (i * 0x9E3779B97F4A7C15) & mask);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * PACKED_LENGTH);
+}
+BENCHMARK(packed_array_set_value)->DenseRange(1, 64);
+
+static void packed_array_get_value(benchmark::State &state)
+{
+    uint8_t bits = state.range(0);
+    uint64_t mask = value_mask(bits);
+    flbwt::PackedArray A(PACKED_LENGTH, bits);
+
+    for (uint64_t i = 0; i < PACKED_LENGTH; i++)
+        A.set_value(i, (i * 0x9E3779B97F4A7C15) & mask);
+
+    for (auto _ : state)
+    {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < PACKED_LENGTH; i++)
+            sum += A.get_value(i);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * PACKED_LENGTH);
+}
+BENCHMARK(packed_array_get_value)->DenseRange(1, 64);
+
+static void queue_enqueue_dequeue(benchmark::State &state)
+{
+    uint8_t w = state.range(0);
+    uint64_t mask = value_mask(w);
+
+    for (auto _ : state)
+    {
+        flbwt::Queue Q(w);
+        for (uint64_t i = 0; i < QUEUE_LENGTH; i++)
+            Q.enqueue(i & mask);
+
+        uint64_t sum = 0;
+        while (!Q.is_empty())
+            sum += Q.dequeue();
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * QUEUE_LENGTH);
+}
+BENCHMARK(queue_enqueue_dequeue)->Arg(8)->Arg(16)->Arg(32)->Arg(40)->Arg(48)->Arg(64);
+
+static void queue_enqueue_l_dequeue(benchmark::State &state)
+{
+    uint8_t w = state.range(0);
+    uint64_t mask = value_mask(w);
+
+    for (auto _ : state)
+    {
+        flbwt::Queue Q(w);
+        for (uint64_t i = 0; i < QUEUE_LENGTH; i++)
+            Q.enqueue_l(i & mask);
+
+        uint64_t sum = 0;
+        while (!Q.is_empty())
+            sum += Q.dequeue();
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * QUEUE_LENGTH);
+}
+BENCHMARK(queue_enqueue_l_dequeue)->Arg(8)->Arg(32)->Arg(40)->Arg(64);
+
+static void queue_churn(benchmark::State &state)
+{
+    uint8_t w = state.range(0);
+    uint64_t mask = value_mask(w);
+    flbwt::Queue Q(w);
+
+    // blocks are released and taken again from the pool while the queue moves
+    for (uint64_t i = 0; i < QUEUE_BACKLOG; i++)
+        Q.enqueue(i & mask);
+
+    for (auto _ : state)
+    {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < QUEUE_LENGTH; i++)
+        {
+            Q.enqueue(i & mask);
+            sum += Q.dequeue();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * QUEUE_LENGTH);
+}
+BENCHMARK(queue_churn)->Arg(8)->Arg(32)->Arg(40)->Arg(64);
+
+static void queue_bulk(benchmark::State &state)
+{
+    uint8_t w = state.range(0);
+    uint64_t mask = value_mask(w);
+    std::vector<uint64_t> values(QUEUE_LENGTH);
+
+    for (uint64_t i = 0; i < QUEUE_LENGTH; i++)
+        values[i] = i & mask;
+
+    for (auto _ : state)
+    {
+        flbwt::Queue Q(w);
+        Q.enqueue(values.data(), QUEUE_LENGTH);
+        Q.dequeue(values.data(), QUEUE_LENGTH);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * QUEUE_LENGTH);
+}
+BENCHMARK(queue_bulk)->Arg(8)->Arg(32)->Arg(40)->Arg(64);
+
+/**
+ * @brief Distinct random substrings (8 to 24 lowercase letters) stored back to back.
+ */
+static void random_substrings(std::vector<uint8_t> &text, std::vector<uint64_t> &starts)
+{
+    std::mt19937_64 rng(HASH_STRINGS);
+
+    for (uint64_t s = 0; s < HASH_STRINGS; s++)
+    {
+        starts.push_back(text.size());
+
+        uint64_t length = 8 + rng() % 17;
+        for (uint64_t j = 0; j < length; j++)
+            text.push_back('a' + rng() % 26);
+    }
+
+    starts.push_back(text.size());
+    text.push_back('\0');
+}
+
+/**
+ * @brief Table with HASH_STRINGS / load buckets --> range(0) strings share a bucket on average.
+ */
+static flbwt::HashTable *create_table(benchmark::State &state)
+{
+    uint64_t load = state.range(0);
+    flbwt::HashTable *table = new flbwt::HashTable((HASH_STRINGS / load) | 1, HASH_STRINGS * 16, 1,
+                                                   (flbwt::HashType)state.range(1));
+    table->MAX_LOAD_FACTOR = 0; // keep the collision rate fixed
+    return table;
+}
+
+static void hashtable_insert_string(benchmark::State &state)
+{
+    std::vector<uint8_t> text;
+    std::vector<uint64_t> starts;
+    random_substrings(text, starts);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        flbwt::HashTable *table = create_table(state);
+        state.ResumeTiming();
+
+        // every substring is inserted twice: once new, once found
+        for (int round = 0; round < 2; round++)
+        {
+            for (uint64_t s = 0; s < HASH_STRINGS; s++)
+                table->insert_string(starts[s + 1] - starts[s], &text[starts[s]]);
+        }
+
+        state.PauseTiming();
+        delete table;
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * 2 * HASH_STRINGS);
+}
+BENCHMARK(hashtable_insert_string)
+    ->ArgsProduct({{1, 4, 16, 64}, {flbwt::HASH_POLYNOMIAL, flbwt::HASH_WORD}});
+
+static void hashtable_find_name(benchmark::State &state)
+{
+    std::vector<uint8_t> text;
+    std::vector<uint64_t> starts;
+    random_substrings(text, starts);
+
+    flbwt::HashTable *table = create_table(state);
+    for (uint64_t s = 0; s < HASH_STRINGS; s++)
+        table->insert_string(starts[s + 1] - starts[s], &text[starts[s]]);
+
+    for (auto _ : state)
+    {
+        uint64_t sum = 0;
+        for (uint64_t s = 0; s < HASH_STRINGS; s++)
+            sum += table->find_name(starts[s + 1] - starts[s], &text[starts[s]]);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.counters["collisions"] = table->collisions;
+    state.SetItemsProcessed(state.iterations() * HASH_STRINGS);
+    delete table;
+}
+BENCHMARK(hashtable_find_name)
+    ->ArgsProduct({{1, 4, 16, 64}, {flbwt::HASH_POLYNOMIAL, flbwt::HASH_WORD}});
+
+static void hashtable_grow(benchmark::State &state)
+{
+    // substrings of random bytes are nearly all unique --> the table is rehashed repeatedly
+    std::mt19937_64 rng(GROW_STRINGS);
+    std::vector<uint8_t> text(GROW_STRINGS * 4 + 2);
+    for (uint64_t i = 0; i < text.size(); i++)
+        text[i] = rng() & 255;
+
+    for (auto _ : state)
+    {
+        flbwt::HashTable table(flbwt::HashTable::recommended_size(text.size()), text.size(), 1,
+                               (flbwt::HashType)state.range(0));
+
+        // S* substrings have at least 3 characters (length 2 marks a block pointer)
+        for (uint64_t s = 0; s + 6 <= text.size(); s += 4)
+            table.insert_string(3 + text[s] % 3, &text[s + 1]);
+
+        state.counters["buf_bytes"] = table.bufsize;
+        state.counters["buckets"] = table.HTSIZE;
+    }
+
+    state.SetItemsProcessed(state.iterations() * GROW_STRINGS);
+}
+BENCHMARK(hashtable_grow)->Arg(flbwt::HASH_POLYNOMIAL)->Arg(flbwt::HASH_WORD);
+
+BENCHMARK_MAIN();
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include "hashtable.hpp"
+#include "packed_array.hpp"
+#include "queue.hpp"
 
 namespace flbwt
 {
@@ -31,6 +33,9 @@ namespace flbwt
         uint8_t bwp_width;
         uint64_t sa_max_value;
         uint8_t *lastptr;
+        flbwt::Queue **occurrences;        // ordinals of the S* substrings from right to left (NULL if not recorded)
+        uint64_t num_of_occurrence_queues; // occurrences are split into queues (one per scanned chunk)
+        flbwt::PackedArray *ordinal_names; // name of the substring for each ordinal
 
         /**
      * @brief Construct a new Container object.
@@ -39,6 +44,11 @@ namespace flbwt
      */
         Container(uint64_t n);
 
+        /**
+     * @brief Release the recorded occurrences and the names of their ordinals.
+     */
+        void release_occurrences();
+
         /**
      * @brief Destroy the Container object.
      */
@@ -4,19 +4,48 @@
 #include <stdint.h>
 #include "container.hpp"
 #include "packed_array.hpp"
-#include "induce32bit.hpp"
+#include "induce.hpp"
+#include "sais.hpp"
+#include "stats.hpp"
+#include "workspace.hpp"
 
 namespace flbwt
 {
 
+/**
+ * @brief Options for controlling how the BWT is constructed.
+ */
+struct BWT_options
+{
+    bool mmap_input;  // map the input file into memory instead of reading it (bwt_file only)
+    bool mmap_output; // induce the BWT directly into the mapped output file (bwt_file only)
+    unsigned threads; // number of threads used by the parallel phases
+    flbwt::HashType hash_type; // hash function of the S* substring hashtable
+    bool record_occurrences;   // remember the S* substrings while extracting --> T1 is built without rehashing T
+    flbwt::SALayout sa_layout; // layout of the 40/48/56-bit suffix arrays
+    uint8_t min_sa_bits;       // use at least this wide SA storage (0 --> narrowest that fits)
+    flbwt::Stats *stats;       // filled with phase timings and counts (NULL --> not collected)
+    const char *scratch_dir;   // queue spilling mode: induce queues spill to a scratch file here (NULL --> in memory)
+    uint64_t ram_budget;       // bytes of heap the induce queues may take the process to before spilling
+                               // (0 --> every full block spills), the SA of T1 is not spilled and must fit in it
+    uint64_t max_memory;       // the strategy is chosen to keep the estimated peak under this (0 --> no limit)
+
+    /**
+     * @brief Construct options with default values.
+     */
+    BWT_options();
+};
+
 /**
  * @brief Function for performing Burrows-Wheeler Transform for 
  * the input file and writing the result to the output file.
  * 
  * @param input_filename filename (path) of the input file
  * @param output_filename filename (path) of the output file
+ * @param options construction options
  */
-void bwt_file(const char *input_filename, const char *output_filename);
+void bwt_file(const char *input_filename, const char *output_filename,
+              const flbwt::BWT_options &options = flbwt::BWT_options());
 
 /**
  * @brief Function for performing Burrows-Wheeler Transform for
@@ -27,39 +56,88 @@ void bwt_file(const char *input_filename, const char *output_filename);
  * @param T input string
  * @param n length of the input string
  * @param free_T free input string if not needed anymore (more efficient)
+ * @param options construction options
  * @return flbwt::BWT_result* result of BWT
  */
-flbwt::BWT_result *bwt_string(uint8_t *T, const uint64_t n, bool free_T);
+flbwt::BWT_result *bwt_string(uint8_t *T, const uint64_t n, bool free_T,
+                              const flbwt::BWT_options &options = flbwt::BWT_options());
 
 // REST OF THE FUNCTIONS ARE NOT MEANT FOR THE USER (ONLY FOR TESTING)
 
+/**
+ * @brief Estimated memory footprint and the strategy chosen for it (see plan_memory).
+ */
+struct Memory_plan
+{
+    uint64_t phase_bytes[flbwt::NUM_OF_PHASES]; // estimated peak of each phase (heap and resident T)
+    uint64_t peak_bytes;                        // maximum of the phases
+    flbwt::Phase peak_phase;                    // phase of the peak
+    bool keep_T;                                // T stays resident and T1 is built by rehashing it
+    bool spill_queues;                          // induce queues spill to a scratch file
+    uint64_t ram_budget;                        // heap the spilled induce queues may take the process to
+    uint64_t queue_block_size;                  // elements in a single induce queue block
+    unsigned threads;                           // threads of the SA-IS and induce phases
+};
+
+/**
+ * @brief Estimate the footprint of the phases after sort_LMS_strings from the
+ * container and choose the strategy for the memory limit. Until the estimate
+ * fits, the first change that lowers the peak is applied: rehash T instead of
+ * keeping the recorded occurrences, spill the induce queues, run the remaining
+ * phases with a single thread, halve the induce queue blocks. If it never fits,
+ * the plan is still returned (peak_bytes > max_memory).
+ * 
+ * @param container container (after sort_LMS_strings)
+ * @param max_memory memory limit in bytes (0 --> no limit)
+ * @param T_bytes bytes of T on the heap (0 if T is mapped from a file)
+ * @param free_T T can be released
+ * @param BWT_buffered the BWT is written to a buffer given by the caller
+ * @param sa_bits width of the SA storage
+ * @param options construction options
+ * @return flbwt::Memory_plan plan
+ */
+flbwt::Memory_plan plan_memory(flbwt::Container *container, uint64_t max_memory, uint64_t T_bytes, bool free_T,
+                               bool BWT_buffered, uint8_t sa_bits, const flbwt::BWT_options &options);
+
 /**
  * @brief Function for extracting S* substrings from the input string.
  * However, the last S* substring T(n) will be ignored.
  * 
  * @param T input string
  * @param n length of the input string
+ * @param threads number of threads scanning the input string
+ * @param hash_type hash function of the S* substring hashtable
+ * @param record_occurrences record the ordinal of every S* substring for create_shortened_string
  * @return container
  */
-flbwt::Container *extract_LMS_strings(uint8_t *T, const uint64_t n);
+flbwt::Container *extract_LMS_strings(uint8_t *T, const uint64_t n, unsigned threads = 1,
+                                      flbwt::HashType hash_type = flbwt::HASH_WORD,
+                                      bool record_occurrences = false);
 
 /**
  * @brief Function for sorting LMS substrings. 
  * 
  * @param T input string
  * @param container container object
+ * @param threads number of threads sorting the substrings
+ * @param workspace the result and the sort keys are arenas of the workspace (NULL --> mem_alloc)
+ * @return uint8_t** sorted unique substrings from S[1] on (owned by the workspace, else release with mem_free)
  */
-uint8_t **sort_LMS_strings(uint8_t *T, flbwt::Container *container);
+uint8_t **sort_LMS_strings(uint8_t *T, flbwt::Container *container, unsigned threads = 1,
+                           flbwt::Workspace *workspace = NULL);
 
 /**
- * @brief Create a shortened string T1.
+ * @brief Create a shortened string T1. If the container has recorded
+ * occurrences, T is not read (and can be NULL).
  * 
  * @param T input string
  * @param n length of input string
  * @param container container object
+ * @param workspace T1 is packed in an arena of the workspace (NULL --> owned by T1)
  * @return flbwt::PackedArray* T1
  */
-flbwt::PackedArray *create_shortened_string(uint8_t *T, const uint64_t n, flbwt::Container *container);
+flbwt::PackedArray *create_shortened_string(uint8_t *T, const uint64_t n, flbwt::Container *container,
+                                            flbwt::Workspace *workspace = NULL);
 
 }
 
@@ -2,6 +2,8 @@
 #define FLBWT_HASHTABLE_HPP
 
 #include <stdint.h>
+#include <atomic>
+#include <mutex>
 
 namespace flbwt
 {
@@ -12,7 +14,8 @@ namespace flbwt
      * 2. x bytes (when combined --> total length),
      * 3. sentinel character (one byte), 
      * 4. substring characters (total length * 1 byte)
-     * 5. bytes for name (when combined --> name)
+     * 5. bytes for name (when combined --> name). Until the names are assigned
+     *    these bytes hold the ordinal of the substring (order of insertion).
      * 
      * POINTER to the next block is a special case with the following format:
      * 1. length x in bytes (how many bytes need to store the length),
@@ -21,6 +24,28 @@ namespace flbwt
      * 4. next 8 bytes store the position of the next element block
      */
 
+    /**
+     * @brief Hash functions available for the HashTable.
+     */
+    enum HashType
+    {
+        HASH_POLYNOMIAL, // byte at a time polynomial hash, reduced with modulo
+        HASH_WORD        // 8 bytes at a time multiplicative hash, reduced with fastrange
+    };
+
+    /**
+     * @brief Memory arena of one hashtable shard. Buckets h with
+     * h % SHARDS == i store their substrings in the arena of shard i.
+     */
+    struct HashShard
+    {
+        uint8_t *buf;        // memory for storing the substrings
+        uint64_t bufsize;    // size of the buf memory
+        uint64_t collisions; // number of collisions with other substrings
+        uint64_t strings;    // number of substrings stored in the shard
+        std::mutex lock;     // lock for inserting substrings to the shard
+    };
+
     /**
      * @brief HashTable class for storing substrings.
      */
@@ -28,23 +53,36 @@ namespace flbwt
     {
     public:
         uint64_t HTSIZE;             // hash table size
-        uint64_t HBSIZE;             // how many bytes buf is increased when resized
+        uint64_t HBSIZE;             // free bytes of a new element block (set from the load factor by rehash)
         uint64_t *rest;              // array keeping track how much space there is left
         uint64_t *head;              // array keeping track of records (hash values are indices for this)
         uint8_t *buf;                // memory for storing the substrings
         uint64_t bufsize;            // size of the buf memory
         uint64_t collisions;         // number of collisions with other substrings
+        uint64_t num_of_strings;     // number of substrings stored in the table
+        uint64_t MAX_LOAD_FACTOR;    // rehash when there are more substrings per bucket (0 --> never)
+        uint64_t MAX_HTSIZE;         // rehash does not grow the table over this size
+        std::atomic<uint64_t> next_ordinal; // ordinal of the next inserted substring
         uint8_t LENGTH_X_BYTES;      // how many bytes needed to store length X
         uint8_t NAME_BYTES;          // number of bytes needed for the name
         uint8_t SENTINEL_CHAR_BYTES; // number of bytes needed for sentinel
+        flbwt::HashType HASH_TYPE;   // hash function used for the substrings
+        uint64_t SHARDS;             // number of shards (1 --> substrings are stored directly to buf)
+        flbwt::HashShard *shards;    // shard arenas (NULL if not sharded)
 
         /**
-         * @brief Construct a new Hash Table object.
+         * @brief Construct a new Hash Table object. With more than one shard
+         * insert_string can be called concurrently from multiple threads (a shard
+         * that fills up grows the whole table with every shard locked).
+         * Shards must be merged with merge_shards before any other operation.
          * 
          * @param hash_table_size size of the table
          * @param n input string length
+         * @param shards number of shards
+         * @param hash_type hash function used for the substrings
          */
-        HashTable(const uint64_t hash_table_size, const uint64_t n);
+        HashTable(const uint64_t hash_table_size, const uint64_t n, const uint64_t shards = 1,
+                  const flbwt::HashType hash_type = flbwt::HASH_POLYNOMIAL);
 
         /**
          * @brief Insert substring to hashtable if it does not exists there yet.
@@ -57,6 +95,43 @@ namespace flbwt
          */
         uint8_t insert_string(const uint64_t m, uint8_t *p);
 
+        /**
+         * @brief Insert substring to hashtable if it does not exists there yet,
+         * and get the ordinal of the stored substring. Ordinals are unique and
+         * stay valid until the names are set.
+         * 
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @param ordinal ordinal of the substring (output)
+         * @return uint8_t operation status
+         */
+        uint8_t insert_string(const uint64_t m, uint8_t *p, uint64_t &ordinal);
+
+        /**
+         * @brief Concatenate the shard arenas into buf. After merging the
+         * hashtable works as if it was never sharded. The table is rehashed
+         * if the shards filled it over the maximum load factor.
+         */
+        void merge_shards();
+
+        /**
+         * @brief Move all substrings to a table of a new size. A sharded table
+         * keeps bucket h in the arena of shard h % SHARDS, every shard must be
+         * locked (insert_string does that when it grows the table).
+         * 
+         * @param hash_table_size new size of the table
+         */
+        void rehash(const uint64_t hash_table_size);
+
+        /**
+         * @brief Get a good initial table size for the input string. The table
+         * grows with rehash if the input has more unique substrings than expected.
+         * 
+         * @param n input string length
+         * @return uint64_t table size
+         */
+        static uint64_t recommended_size(const uint64_t n);
+
         /**
          * @brief Function for calculating hash for substring.
          * 
@@ -66,6 +141,15 @@ namespace flbwt
          */
         uint64_t hash_function(const uint64_t m, uint8_t *p);
 
+        /**
+         * @brief Word at a time hash for substring (HASH_WORD).
+         * 
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @return uint64_t hash
+         */
+        uint64_t word_hash_function(const uint64_t m, uint8_t *p);
+
         /**
          * @brief Get the length of substring.
          * 
@@ -154,6 +238,68 @@ namespace flbwt
          * @brief Destroy the HashTable object.
          */
         ~HashTable();
+
+    private:
+        std::atomic<uint64_t> shared_size; // HTSIZE for the threads hashing before they lock a shard
+
+        /**
+         * @brief Hash of a substring for a table of the given size.
+         * 
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @param size table size
+         * @return uint64_t hash
+         */
+        uint64_t hash_function(const uint64_t m, uint8_t *p, const uint64_t size);
+
+        /**
+         * @brief Word at a time hash for a table of the given size (HASH_WORD).
+         * 
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @param size table size
+         * @return uint64_t hash
+         */
+        uint64_t word_hash_function(const uint64_t m, uint8_t *p, const uint64_t size);
+
+        /**
+         * @brief Grow a sharded table with every shard locked, unless another
+         * thread did it already.
+         * 
+         * @param size table size the calling thread found too full
+         */
+        void grow_shards(const uint64_t size);
+
+        /**
+         * @brief Append substring to the end of the bucket without checking
+         * whether it is already there.
+         * 
+         * @param h hash of the substring
+         * @param q position of the end of the bucket (0 if bucket is empty)
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @param ordinal value stored to the name bytes
+         * @param buf memory arena of the bucket
+         * @param bufsize size of the memory arena
+         * @return uint8_t* pointer to the stored substring
+         */
+        uint8_t *append_string(const uint64_t h, uint64_t q, const uint64_t m, uint8_t *p,
+                               const uint64_t ordinal, uint8_t *&buf, uint64_t &bufsize);
+
+        /**
+         * @brief Insert substring to the given memory arena.
+         * 
+         * @param h hash of the substring
+         * @param m length of the substring
+         * @param p pointer to the beginning of the substring
+         * @param buf memory arena of the bucket
+         * @param bufsize size of the memory arena
+         * @param collisions collision counter of the arena
+         * @param ordinal ordinal of the substring (output)
+         * @return uint8_t operation status
+         */
+        uint8_t insert_string(const uint64_t h, const uint64_t m, uint8_t *p,
+                              uint8_t *&buf, uint64_t &bufsize, uint64_t &collisions, uint64_t &ordinal);
     };
 
 }
@@ -0,0 +1,44 @@
+#ifndef FLBWT_INDUCE_HPP
+#define FLBWT_INDUCE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "container.hpp"
+#include "queue.hpp"
+#include "stats.hpp"
+#include "workspace.hpp"
+
+namespace flbwt
+{
+    struct BWT_result 
+    {
+        uint64_t last;
+        uint8_t *BWT;
+    };
+
+    /**
+     * @brief Function for inducing the BWT for the original input string T.
+     * If BWT is NULL, the buffer (n + 1 bytes, BWT[last] is unused) is allocated with new[] or,
+     * with a workspace, taken from it. A given buffer receives the n characters only, the slot
+     * of the sentinel is skipped. SA is released (given back to the workspace) by this function.
+     *
+     * Instantiated for SAStorage32, SAStorage40, SAStorage48, SAStorage56, SAStorage64
+     * and SAStoragePacked40/48/56.
+     *
+     * @tparam Storage suffix array storage policy (see sais.hpp)
+     * @param SA sorted S* substrings (offsets of their last characters from bwp_base)
+     * @param container container
+     * @param BWT output buffer (n bytes) or NULL
+     * @param threads number of threads reading the characters preceding the queued suffixes
+     * @param stats statistics to add the allocated queue blocks to (NULL --> not collected)
+     * @param pool pool of the queue blocks, e.g. one spilling to a scratch file (NULL --> private pool)
+     * @param workspace workspace SA was placed in (NULL --> SA owns its memory)
+     * @return flbwt::BWT_result* result
+     */
+    template <class Storage>
+    flbwt::BWT_result *induce_bwt(Storage SA, flbwt::Container *container, uint8_t *BWT = NULL, unsigned threads = 1,
+                                  flbwt::Stats *stats = NULL, flbwt::QueuePool *pool = NULL,
+                                  flbwt::Workspace *workspace = NULL);
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef FLBWT_MEMORY_HPP
+#define FLBWT_MEMORY_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+
+/*
+ * Accounting of the heap memory used by flbwt for its working data (hashtable,
+ * sorted substrings, T1, suffix arrays, queues and the BWT buffer). The input
+ * string and memory mapped files are not counted. The counters are shared by
+ * all threads of the process.
+ */
+
+namespace flbwt
+{
+
+/**
+ * @brief Allocate counted memory (like malloc).
+ * 
+ * @param size number of bytes
+ * @return void* memory or NULL if the allocation failed
+ */
+void *mem_alloc(size_t size);
+
+/**
+ * @brief Resize counted memory (like realloc, ptr can be NULL).
+ * 
+ * @param ptr memory from mem_alloc/mem_realloc or NULL
+ * @param size new number of bytes
+ * @return void* memory or NULL if the allocation failed (ptr is still valid)
+ */
+void *mem_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Free counted memory (like free, ptr can be NULL).
+ * 
+ * @param ptr memory from mem_alloc/mem_realloc or NULL
+ */
+void mem_free(void *ptr);
+
+/**
+ * @brief Count memory that was allocated elsewhere (e.g. a buffer returned to the user).
+ * 
+ * @param bytes number of bytes
+ */
+void mem_track(uint64_t bytes);
+
+/**
+ * @brief Stop counting memory added with mem_track.
+ * 
+ * @param bytes number of bytes
+ */
+void mem_untrack(uint64_t bytes);
+
+/**
+ * @brief Get the number of counted bytes currently allocated.
+ * 
+ * @return int64_t bytes
+ */
+int64_t mem_current();
+
+/**
+ * @brief Get the highest number of counted bytes since the last mem_reset_peak.
+ * 
+ * @return int64_t bytes
+ */
+int64_t mem_peak();
+
+/**
+ * @brief Start a new high-water mark from the current allocation.
+ */
+void mem_reset_peak();
+
+/**
+ * @brief Allocate a counted array of n trivially constructible values (like new[]).
+ * Throws std::bad_alloc if the allocation fails.
+ * 
+ * @tparam T value type
+ * @param n number of values
+ * @return T* array (release with mem_free)
+ */
+template <class T>
+T *mem_new_array(uint64_t n)
+{
+    T *A = (T *)flbwt::mem_alloc(n * sizeof(T));
+
+    if (A == NULL && n != 0)
+        throw std::bad_alloc();
+
+    return A;
+}
+
+}
+
+#endif
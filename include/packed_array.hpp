@@ -6,13 +6,71 @@
 
 // https://stackoverflow.com/questions/22899466/this-declaration-has-no-storage-class-or-type-specifier-in-c
 #define BIT_MASK(__TYPE__, __ONE_COUNT__) \
-    ((__TYPE__) (-((__ONE_COUNT__) != 0))) \
-    & (((__TYPE__) -1) >> ((sizeof(__TYPE__) * CHAR_BIT) - (__ONE_COUNT__)))
+    (((__ONE_COUNT__) == 0) ? (__TYPE__) 0 \
+    : (((__TYPE__) -1) >> ((sizeof(__TYPE__) * CHAR_BIT) - (__ONE_COUNT__))))
 
 namespace flbwt {
 
+/**
+ * @brief Access to packed integers whose width is known at compile time.
+ * Uses the same layout as PackedArray (most significant bits first), so the
+ * functions work on the raw data of a PackedArray with integer_bits == Bits.
+ * Masks and shifts are folded by the compiler, widths dividing 64 never take
+ * the straddling path.
+ * 
+ * @tparam Bits bits used by single integer (1..64)
+ */
+template <unsigned Bits>
+struct FixedPackedArray
+{
+    static inline uint64_t get_value(const uint64_t *arr, uint64_t index)
+    {
+        const uint64_t mask = BIT_MASK(uint64_t, Bits);
+        uint64_t bit = index * Bits;
+        uint64_t w = bit / 64;
+        unsigned end = bit % 64 + Bits;
+
+        if (64 % Bits == 0 || end <= 64)
+            return (arr[w] >> ((64 - end) & 63)) & mask;
+
+        return ((arr[w] << (end - 64)) | (arr[w + 1] >> ((128 - end) & 63))) & mask;
+    }
+
+    static inline void set_value(uint64_t *arr, uint64_t index, uint64_t value)
+    {
+        const uint64_t mask = BIT_MASK(uint64_t, Bits);
+        uint64_t bit = index * Bits;
+        uint64_t w = bit / 64;
+        unsigned end = bit % 64 + Bits;
+
+        if (64 % Bits == 0 || end <= 64)
+        {
+            unsigned shift = (64 - end) & 63;
+            arr[w] = (arr[w] & ~(mask << shift)) | (value << shift);
+            return;
+        }
+
+        unsigned rest = end - 64; // bits stored in the next word
+        arr[w] = (arr[w] & ~(mask >> rest)) | (value >> rest);
+        arr[w + 1] = (arr[w + 1] & (~(uint64_t)0 >> rest)) | (value << (64 - rest));
+    }
+
+    static void unpack(const uint64_t *arr, uint64_t index, uint64_t count, uint64_t *out)
+    {
+        for (uint64_t i = 0; i < count; i++)
+            out[i] = get_value(arr, index + i);
+    }
+
+    static void pack(uint64_t *arr, uint64_t index, uint64_t count, const uint64_t *in)
+    {
+        for (uint64_t i = 0; i < count; i++)
+            set_value(arr, index + i, in[i]);
+    }
+};
+
 /**
  * @brief Array like data structure that stores integers space efficiently. 
+ * Widths 8, 16 and 32 are dispatched to FixedPackedArray. 
  */
 class PackedArray
 {
@@ -25,6 +83,16 @@ public:
      */
     PackedArray(uint64_t length, uint8_t integer_bits);
 
+    /**
+     * @brief Construct a new PackedArray object in memory owned by the caller
+     * (e.g. an arena of a Workspace). The memory is not freed by the destructor.
+     * 
+     * @param length length of the PackedArray
+     * @param integer_bits bits used by single integer in PackedArray
+     * @param arr memory of at least words_required(length, integer_bits) words
+     */
+    PackedArray(uint64_t length, uint8_t integer_bits, uint64_t *arr);
+
     /**
      * @brief Get the length of the PackedArray.
      * 
@@ -55,6 +123,75 @@ public:
      */
     uint64_t get_value(uint64_t index);
 
+    /**
+     * @brief Store value at index in raw packed integer data.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index where value is stored
+     * @param value value to be stored
+     */
+    static void set_value(uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t value);
+
+    /**
+     * @brief Get value stored at index in raw packed integer data.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index from which value is retrieved
+     * @return uint64_t value
+     */
+    static uint64_t get_value(const uint64_t *arr, uint8_t integer_bits, uint64_t index);
+
+    /**
+     * @brief Read count consecutive values starting at index.
+     * 
+     * @param index index of the first value
+     * @param count number of values
+     * @param out buffer for the values
+     */
+    void unpack(uint64_t index, uint64_t count, uint64_t *out);
+
+    /**
+     * @brief Store count consecutive values starting at index.
+     * 
+     * @param index index of the first value
+     * @param count number of values
+     * @param in values to be stored
+     */
+    void pack(uint64_t index, uint64_t count, const uint64_t *in);
+
+    /**
+     * @brief Read count consecutive values from raw packed integer data.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index of the first value
+     * @param count number of values
+     * @param out buffer for the values
+     */
+    static void unpack(const uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t count, uint64_t *out);
+
+    /**
+     * @brief Store count consecutive values to raw packed integer data.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index of the first value
+     * @param count number of values
+     * @param in values to be stored
+     */
+    static void pack(uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t count, const uint64_t *in);
+
+    /**
+     * @brief Number of 64-bit words needed for packed integers.
+     * 
+     * @param length number of integers
+     * @param integer_bits bits used by single integer
+     * @return uint64_t number of words
+     */
+    static uint64_t words_required(uint64_t length, uint8_t integer_bits);
+
     /**
      * @brief Get the pointer pointing to raw integer data.
      * 
@@ -72,6 +209,108 @@ private:
     uint64_t length;            // length of the packed array
     uint8_t integer_bits;       // number of bits for single integer
     uint64_t arr_length;        // length of raw data of arr
+    bool owns_arr;              // arr is freed by the destructor
+};
+
+/**
+ * @brief Sequential reader of packed integers. Keeps the current word in a
+ * shift register, so every value costs a shift and at most one load.
+ */
+class PackedArrayReader
+{
+public:
+    /**
+     * @brief Construct a new PackedArrayReader object.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index of the first value to be read
+     */
+    PackedArrayReader(const uint64_t *arr, uint8_t integer_bits, uint64_t index);
+
+    /**
+     * @brief Read the next value.
+     * 
+     * @return uint64_t value
+     */
+    inline uint64_t next()
+    {
+        uint64_t value;
+
+        if (this->avail >= this->bits)
+        {
+            value = this->word >> (64 - this->bits);
+            this->word = (this->word << (this->bits - 1)) << 1;
+            this->avail -= this->bits;
+            return value;
+        }
+
+        // value continues in the next word
+        uint8_t need = this->bits - this->avail;
+        uint64_t w = *this->p++;
+        value = (this->avail == 0) ? 0 : (this->word >> (64 - this->avail)) << need;
+        value |= w >> (64 - need);
+        this->word = (w << (need - 1)) << 1;
+        this->avail = 64 - need;
+        return value;
+    }
+
+private:
+    const uint64_t *p; // next word to be loaded
+    uint64_t word;     // unread bits of the current word (most significant first)
+    uint8_t avail;     // number of unread bits in word
+    uint8_t bits;      // bits used by single integer
+};
+
+/**
+ * @brief Sequential writer of packed integers. Values are collected into a
+ * word that is stored once it is full. Call flush() after the last value.
+ */
+class PackedArrayWriter
+{
+public:
+    /**
+     * @brief Construct a new PackedArrayWriter object.
+     * 
+     * @param arr raw integer data
+     * @param integer_bits bits used by single integer
+     * @param index index of the first value to be written
+     */
+    PackedArrayWriter(uint64_t *arr, uint8_t integer_bits, uint64_t index);
+
+    /**
+     * @brief Write the next value.
+     * 
+     * @param value value (must fit into integer_bits)
+     */
+    inline void put(uint64_t value)
+    {
+        uint8_t free = 64 - this->used;
+
+        if (this->bits < free)
+        {
+            this->word |= value << (free - this->bits);
+            this->used += this->bits;
+            return;
+        }
+
+        // current word becomes full
+        uint8_t rest = this->bits - free;
+        *this->p++ = this->word | (value >> rest);
+        this->word = (rest == 0) ? 0 : value << (64 - rest);
+        this->used = rest;
+    }
+
+    /**
+     * @brief Store the partially filled word (bits after the last value are kept).
+     */
+    void flush();
+
+private:
+    uint64_t *p;   // word being filled
+    uint64_t word; // collected bits of the current word (most significant first)
+    uint8_t used;  // number of collected bits in word (< 64)
+    uint8_t bits;  // bits used by single integer
 };
 
 }
@@ -2,7 +2,10 @@
 #define FLBWT_QUEUE_HPP
 
 #include <stdint.h>
+#include <deque>
+#include <vector>
 #include "packed_array.hpp"
+#include "workspace.hpp"
 
 namespace flbwt
 {
@@ -11,10 +14,145 @@ struct qblock
 {
     qblock *prev;
     qblock *next;
-    flbwt::PackedArray *b;
+    uint64_t *b; // packed values of the block
 };
 
 #define QSIZ 1024
+#define QSLAB_BLOCKS 64
+#define QBATCH 256 // values taken by a single bulk dequeue in the induce loops
+
+/**
+ * @brief Pool of fixed size queue blocks.
+ * 
+ * Blocks are carved out of slabs of QSLAB_BLOCKS blocks and recycled through
+ * a free list, so queues sharing a pool do not touch the heap once the pool
+ * has grown to the peak number of blocks in use.
+ *
+ * With a scratch file the pool can spill: when a new slab would take the
+ * counted heap (memory.hpp) over the RAM budget, queues write full blocks
+ * to the scratch file instead of taking new ones.
+ */
+class QueuePool
+{
+public:
+    /**
+     * @brief Construct a new QueuePool object.
+     * 
+     * @param w width of elements in bits
+     * @param block_size number of elements in a single block
+     */
+    QueuePool(uint8_t w, uint64_t block_size = QSIZ);
+
+    /**
+     * @brief Take a block from the free list (allocate a new slab if it is empty).
+     * 
+     * @return flbwt::qblock* block
+     */
+    flbwt::qblock *allocate();
+
+    /**
+     * @brief Return block to the free list.
+     * 
+     * @param qb block
+     */
+    void release(flbwt::qblock *qb);
+
+    /**
+     * @brief Get the width of elements in bits.
+     * 
+     * @return uint8_t width
+     */
+    uint8_t get_width();
+
+    /**
+     * @brief Get the number of elements in a single block.
+     * 
+     * @return uint64_t block size
+     */
+    uint64_t get_block_size();
+
+    /**
+     * @brief Get the number of blocks carved out of slabs so far.
+     * 
+     * @return uint64_t number of blocks
+     */
+    uint64_t get_num_of_blocks();
+
+    /**
+     * @brief Spill blocks to a scratch file in the directory when the counted
+     * heap would grow over the RAM budget. The file is removed right away and
+     * disappears when the pool is destroyed.
+     * 
+     * @param directory directory of the scratch file
+     * @param ram_budget bytes of counted heap that new slabs may take the process to
+     */
+    void set_scratch(const char *directory, uint64_t ram_budget);
+
+    /**
+     * @brief Carve new slabs out of the arenas given back to the workspace before
+     * taking them from the heap. The workspace must outlive the pool.
+     * 
+     * @param workspace workspace or NULL
+     */
+    void set_workspace(flbwt::Workspace *workspace);
+
+    /**
+     * @brief Check whether a queue should spill a full block instead of taking a new one.
+     * 
+     * @return true there are no free blocks and a new slab would go over the budget
+     * @return false a block can be taken
+     */
+    bool must_spill();
+
+    /**
+     * @brief Write the values of a block to the scratch file.
+     * 
+     * @param b packed values of the block
+     * @return uint64_t position of the block in the scratch file
+     */
+    uint64_t spill(const uint64_t *b);
+
+    /**
+     * @brief Read the values of a spilled block back (the position can be reused after this).
+     * 
+     * @param offset position of the block in the scratch file
+     * @param b packed values of the block (output)
+     */
+    void restore(uint64_t offset, uint64_t *b);
+
+    /**
+     * @brief Forget a spilled block without reading it.
+     * 
+     * @param offset position of the block in the scratch file
+     */
+    void discard(uint64_t offset);
+
+    /**
+     * @brief Get the number of blocks written to the scratch file so far.
+     * 
+     * @return uint64_t number of blocks
+     */
+    uint64_t get_num_of_spilled_blocks();
+
+    /**
+     * @brief Destroy the QueuePool object (frees all slabs, closes the scratch file).
+     */
+    ~QueuePool();
+
+private:
+    uint8_t w;            // width of elements in bits
+    uint64_t block_size;  // elements in a single block
+    uint64_t block_words; // 64-bit words in a single block
+    uint64_t num_of_blocks;
+    flbwt::qblock *free_blocks;
+    void *slabs; // singly linked list of slabs, link stored in the first word
+    int scratch_fd;       // scratch file (-1 --> blocks are never spilled)
+    uint64_t ram_budget;  // limit of counted heap for new slabs
+    uint64_t scratch_end; // end of the scratch file
+    uint64_t num_of_spilled_blocks;
+    std::vector<uint64_t> free_offsets; // positions of the scratch file that can be reused
+    flbwt::Workspace *workspace;        // source of the slabs before the heap (NULL --> heap only)
+};
 
 /**
  * @brief Queue class.
@@ -23,10 +161,17 @@ class Queue
 {
 public:
     /**
-     * @brief Construct a new Queue object.
+     * @brief Construct a new Queue object with private block pool.
      */
     Queue(uint8_t w);
 
+    /**
+     * @brief Construct a new Queue object taking blocks from shared pool.
+     * 
+     * @param pool block pool (must outlive the queue)
+     */
+    Queue(flbwt::QueuePool *pool);
+
     /**
      * @brief Insert value to the end of the queue.
      * 
@@ -34,6 +179,14 @@ public:
      */
     void enqueue(uint64_t x);
 
+    /**
+     * @brief Insert values to the end of the queue.
+     * 
+     * @param x values
+     * @param count number of values
+     */
+    void enqueue(const uint64_t *x, uint64_t count);
+
     /**
      * @brief Insert value to the beginning of the queue.
      * 
@@ -48,6 +201,15 @@ public:
      */
     int64_t dequeue();
 
+    /**
+     * @brief Remove at most count values from the beginning of the queue.
+     * 
+     * @param x buffer for the removed values
+     * @param count maximum number of values
+     * @return uint64_t number of values removed
+     */
+    uint64_t dequeue(uint64_t *x, uint64_t count);
+
     /**
      * @brief Check wheter queue is empty or not.
      * 
@@ -56,6 +218,20 @@ public:
      */
     bool is_empty();
 
+    /**
+     * @brief Get the number of elements in the queue.
+     * 
+     * @return uint64_t number of elements
+     */
+    uint64_t size();
+
+    /**
+     * @brief Get the pool the blocks of the queue come from.
+     * 
+     * @return flbwt::QueuePool* block pool
+     */
+    flbwt::QueuePool *get_pool();
+
     /**
      * @brief Destroy the Queue object.
      */
@@ -64,13 +240,21 @@ public:
 private:
     uint64_t n; // number of elements
     uint8_t w;  // width of elements in bits
+    flbwt::QueuePool *pool;
+    bool owns_pool;
+    int64_t bsize; // elements in a single block
     flbwt::qblock *sb;
     flbwt::qblock *eb;
     int64_t s_ofs; // 0 <= s_ofs
-    int64_t e_ofs; // e_ofs < QSIZ
-    uint64_t max_value;  // max unsigned integer that can be stored
+    int64_t e_ofs; // e_ofs < bsize
+    std::deque<uint64_t> spilled; // scratch file positions of the blocks between eb->prev and eb
+
+    /**
+     * @brief Release the first block.
+     */
+    void drop_first_block();
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,245 @@
+#ifndef FLBWT_SAIS_HPP
+#define FLBWT_SAIS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "memory.hpp"
+#include "packed_array.hpp"
+#include "sais40bit.hpp"
+#include "sais48bit.hpp"
+#include "sais56bit.hpp"
+
+/*
+ * Modified version of the Yuta Mori's SAIS implementation.
+ *
+ * The algorithm is written once over a storage policy. A storage policy is a
+ * small value type that behaves like a pointer to signed integers: get(i),
+ * set(i, v), prefetch(i) and operator+ (offset). Split storages keep the low
+ * 32 bits and the high bits in separate arrays, packed storages keep every entry in
+ * consecutive bytes. A storage is either allocated (allocate/release) or placed
+ * in an arena of bytes(n) bytes (place/get_arena), e.g. from a Workspace.
+ */
+
+namespace flbwt
+{
+
+enum SALayout
+{
+    SA_LAYOUT_SPLIT,  // 40/48/56-bit SA as separate low and high streams
+    SA_LAYOUT_PACKED  // 40/48/56-bit SA as 5/6/7 consecutive bytes per entry
+};
+
+/**
+ * @brief Suffix array stored in 32 bit integers.
+ */
+struct SAStorage32
+{
+    static const uint8_t BITS = 32;
+    int32_t *A;
+
+    SAStorage32(int32_t *A = NULL) : A(A) {}
+
+    static SAStorage32 allocate(uint64_t n) { return SAStorage32(flbwt::mem_new_array<int32_t>(n)); }
+    void release() { flbwt::mem_free(this->A); }
+
+    static uint64_t bytes(uint64_t n) { return n * sizeof(int32_t); }
+    static SAStorage32 place(void *arena, uint64_t /*n*/) { return SAStorage32((int32_t *)arena); }
+    void *get_arena() const { return this->A; }
+
+    int64_t get(int64_t i) const { return this->A[i]; }
+    void set(int64_t i, int64_t value) const { this->A[i] = value; }
+    void prefetch(int64_t i) const { __builtin_prefetch(this->A + i, 1); }
+
+    SAStorage32 operator+(int64_t ofs) const { return SAStorage32(this->A + ofs); }
+    bool operator==(const SAStorage32 &other) const { return this->A == other.A; }
+};
+
+/**
+ * @brief Suffix array stored in two streams (32 + 8 bits).
+ */
+struct SAStorage40
+{
+    static const uint8_t BITS = 40;
+    uint32_t *L;
+    int8_t *U;
+
+    SAStorage40(uint32_t *L = NULL, int8_t *U = NULL) : L(L), U(U) {}
+
+    static SAStorage40 allocate(uint64_t n)
+    {
+        return SAStorage40(flbwt::mem_new_array<uint32_t>(n), flbwt::mem_new_array<int8_t>(n));
+    }
+    void release() { flbwt::mem_free(this->L); flbwt::mem_free(this->U); }
+
+    static uint64_t bytes(uint64_t n) { return n * (sizeof(uint32_t) + sizeof(int8_t)); }
+    static SAStorage40 place(void *arena, uint64_t n)
+    {
+        return SAStorage40((uint32_t *)arena, (int8_t *)((uint32_t *)arena + n));
+    }
+    void *get_arena() const { return this->L; }
+
+    int64_t get(int64_t i) const { return flbwt::get_40bit_value(this->L, this->U, i); }
+    void set(int64_t i, int64_t value) const { flbwt::set_40bit_value(this->L, this->U, i, value); }
+    void prefetch(int64_t i) const { __builtin_prefetch(this->L + i, 1); __builtin_prefetch(this->U + i, 1); }
+
+    SAStorage40 operator+(int64_t ofs) const { return SAStorage40(this->L + ofs, this->U + ofs); }
+    bool operator==(const SAStorage40 &other) const { return this->L == other.L; }
+};
+
+/**
+ * @brief Suffix array stored in two streams (32 + 16 bits).
+ */
+struct SAStorage48
+{
+    static const uint8_t BITS = 48;
+    uint32_t *L;
+    int16_t *U;
+
+    SAStorage48(uint32_t *L = NULL, int16_t *U = NULL) : L(L), U(U) {}
+
+    static SAStorage48 allocate(uint64_t n)
+    {
+        return SAStorage48(flbwt::mem_new_array<uint32_t>(n), flbwt::mem_new_array<int16_t>(n));
+    }
+    void release() { flbwt::mem_free(this->L); flbwt::mem_free(this->U); }
+
+    static uint64_t bytes(uint64_t n) { return n * (sizeof(uint32_t) + sizeof(int16_t)); }
+    static SAStorage48 place(void *arena, uint64_t n)
+    {
+        return SAStorage48((uint32_t *)arena, (int16_t *)((uint32_t *)arena + n));
+    }
+    void *get_arena() const { return this->L; }
+
+    int64_t get(int64_t i) const { return flbwt::get_48bit_value(this->L, this->U, i); }
+    void set(int64_t i, int64_t value) const { flbwt::set_48bit_value(this->L, this->U, i, value); }
+    void prefetch(int64_t i) const { __builtin_prefetch(this->L + i, 1); __builtin_prefetch(this->U + i, 1); }
+
+    SAStorage48 operator+(int64_t ofs) const { return SAStorage48(this->L + ofs, this->U + ofs); }
+    bool operator==(const SAStorage48 &other) const { return this->L == other.L; }
+};
+
+/**
+ * @brief Suffix array stored in three streams (32 + 16 + 8 bits).
+ */
+struct SAStorage56
+{
+    static const uint8_t BITS = 56;
+    uint32_t *L;
+    uint16_t *M;
+    int8_t *U;
+
+    SAStorage56(uint32_t *L = NULL, uint16_t *M = NULL, int8_t *U = NULL) : L(L), M(M), U(U) {}
+
+    static SAStorage56 allocate(uint64_t n)
+    {
+        return SAStorage56(flbwt::mem_new_array<uint32_t>(n), flbwt::mem_new_array<uint16_t>(n),
+                           flbwt::mem_new_array<int8_t>(n));
+    }
+    void release() { flbwt::mem_free(this->L); flbwt::mem_free(this->M); flbwt::mem_free(this->U); }
+
+    static uint64_t bytes(uint64_t n) { return n * (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(int8_t)); }
+    static SAStorage56 place(void *arena, uint64_t n)
+    {
+        uint16_t *M = (uint16_t *)((uint32_t *)arena + n);
+        return SAStorage56((uint32_t *)arena, M, (int8_t *)(M + n));
+    }
+    void *get_arena() const { return this->L; }
+
+    int64_t get(int64_t i) const { return flbwt::get_56bit_value(this->L, this->M, this->U, i); }
+    void set(int64_t i, int64_t value) const { flbwt::set_56bit_value(this->L, this->M, this->U, i, value); }
+    void prefetch(int64_t i) const
+    {
+        __builtin_prefetch(this->L + i, 1);
+        __builtin_prefetch(this->M + i, 1);
+        __builtin_prefetch(this->U + i, 1);
+    }
+
+    SAStorage56 operator+(int64_t ofs) const { return SAStorage56(this->L + ofs, this->M + ofs, this->U + ofs); }
+    bool operator==(const SAStorage56 &other) const { return this->L == other.L; }
+};
+
+/**
+ * @brief Suffix array stored in Bytes consecutive bytes per entry (little-endian).
+ * Every entry is read with a single unaligned 8 byte load, the allocation is
+ * padded so that the load never crosses its end.
+ */
+template <uint8_t Bytes>
+struct SAStorageBytes
+{
+    static const uint8_t BITS = 8 * Bytes;
+    uint8_t *A;
+
+    SAStorageBytes(uint8_t *A = NULL) : A(A) {}
+
+    static SAStorageBytes allocate(uint64_t n) { return SAStorageBytes(flbwt::mem_new_array<uint8_t>(bytes(n))); }
+    void release() { flbwt::mem_free(this->A); }
+
+    static uint64_t bytes(uint64_t n) { return n * Bytes + 8 - Bytes; }
+    static SAStorageBytes place(void *arena, uint64_t /*n*/) { return SAStorageBytes((uint8_t *)arena); }
+    void *get_arena() const { return this->A; }
+
+    int64_t get(int64_t i) const
+    {
+        int64_t value;
+        memcpy(&value, this->A + i * Bytes, 8);
+        return (int64_t)((uint64_t)value << (64 - BITS)) >> (64 - BITS);
+    }
+
+    void set(int64_t i, int64_t value) const { memcpy(this->A + i * Bytes, &value, Bytes); }
+    void prefetch(int64_t i) const { __builtin_prefetch(this->A + i * Bytes, 1); }
+
+    SAStorageBytes operator+(int64_t ofs) const { return SAStorageBytes(this->A + ofs * Bytes); }
+    bool operator==(const SAStorageBytes &other) const { return this->A == other.A; }
+};
+
+typedef SAStorageBytes<5> SAStoragePacked40;
+typedef SAStorageBytes<6> SAStoragePacked48;
+typedef SAStorageBytes<7> SAStoragePacked56;
+
+/**
+ * @brief Suffix array stored in 64 bit integers.
+ */
+struct SAStorage64
+{
+    static const uint8_t BITS = 64;
+    int64_t *A;
+
+    SAStorage64(int64_t *A = NULL) : A(A) {}
+
+    static SAStorage64 allocate(uint64_t n) { return SAStorage64(flbwt::mem_new_array<int64_t>(n)); }
+    void release() { flbwt::mem_free(this->A); }
+
+    static uint64_t bytes(uint64_t n) { return n * sizeof(int64_t); }
+    static SAStorage64 place(void *arena, uint64_t /*n*/) { return SAStorage64((int64_t *)arena); }
+    void *get_arena() const { return this->A; }
+
+    int64_t get(int64_t i) const { return this->A[i]; }
+    void set(int64_t i, int64_t value) const { this->A[i] = value; }
+    void prefetch(int64_t i) const { __builtin_prefetch(this->A + i, 1); }
+
+    SAStorage64 operator+(int64_t ofs) const { return SAStorage64(this->A + ofs); }
+    bool operator==(const SAStorage64 &other) const { return this->A == other.A; }
+};
+
+/**
+ * @brief Induced sorting for sorting suffixes of a packed string.
+ *
+ * Instantiated for SAStorage32, SAStorage40, SAStorage48, SAStorage56, SAStorage64
+ * and SAStoragePacked40/48/56.
+ *
+ * @tparam Storage suffix array storage policy
+ * @param T packed input string (value i is stored at packed index i + 1)
+ * @param cs width of input string elements
+ * @param SA suffix array (n + fs elements)
+ * @param fs free space at the end of SA
+ * @param n input string length
+ * @param k alphabet size
+ * @param threads number of threads (long strings only)
+ */
+template <class Storage>
+void sais(const uint64_t *T, uint8_t cs, Storage SA, uint64_t fs, uint64_t n, uint64_t k, unsigned threads = 1);
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef FLBWT_STATS_HPP
+#define FLBWT_STATS_HPP
+
+#include <stdint.h>
+#include <time.h>
+#include <chrono>
+#include <ostream>
+
+namespace flbwt
+{
+
+/**
+ * @brief Phases of the BWT construction.
+ */
+enum Phase
+{
+    PHASE_EXTRACT, // extract the S* substrings
+    PHASE_SORT,    // sort and name the S* substrings
+    PHASE_SHORTEN, // build the shortened string T1
+    PHASE_SAIS,    // suffix sort T1
+    PHASE_INDUCE,  // induce the BWT of the input string
+    PHASE_WRITE,   // write the output file (bwt_file only)
+    NUM_OF_PHASES
+};
+
+/**
+ * @brief Timings, memory and counts of a BWT construction. Pass a Stats object
+ * in BWT_options to fill it. Times of a phase add up if the phase is run again.
+ * Memory is the high-water mark of the heap counted by memory.hpp during the phase.
+ */
+class Stats
+{
+public:
+    uint64_t num_of_substrings;        // number of S* substrings
+    uint64_t num_of_unique_substrings; // number of distinct S* substrings
+    uint8_t sa_bits;                   // width of the chosen SA storage (bits per entry)
+    uint64_t hash_collisions;          // collisions in the S* substring hashtable
+    uint64_t queue_blocks;             // queue blocks allocated (occurrence and induce queues)
+    uint64_t spilled_blocks;           // induce queue blocks written to the scratch file
+
+    /**
+     * @brief Construct a new Stats object with everything set to zero.
+     */
+    Stats();
+
+    /**
+     * @brief Set all times and counts to zero.
+     */
+    void reset();
+
+    /**
+     * @brief Start timing the phase.
+     * 
+     * @param phase phase
+     */
+    void start(flbwt::Phase phase);
+
+    /**
+     * @brief Stop timing the phase and add the elapsed time to it.
+     * 
+     * @param phase phase
+     */
+    void stop(flbwt::Phase phase);
+
+    /**
+     * @brief Get the wall clock time of the phase.
+     * 
+     * @param phase phase
+     * @return double seconds
+     */
+    double get_wall_time(flbwt::Phase phase);
+
+    /**
+     * @brief Get the CPU time of the phase (all threads of the process).
+     * 
+     * @param phase phase
+     * @return double seconds
+     */
+    double get_cpu_time(flbwt::Phase phase);
+
+    /**
+     * @brief Get the peak of counted heap memory during the phase.
+     * 
+     * @param phase phase
+     * @return int64_t bytes
+     */
+    int64_t get_peak_memory(flbwt::Phase phase);
+
+    /**
+     * @brief Get the peak of counted heap memory over all phases.
+     * 
+     * @return int64_t bytes
+     */
+    int64_t get_peak_memory();
+
+    /**
+     * @brief Get the name of the phase.
+     * 
+     * @param phase phase
+     * @return const char* name
+     */
+    static const char *get_phase_name(flbwt::Phase phase);
+
+    /**
+     * @brief Print times and counts, one per line.
+     * 
+     * @param out output stream
+     */
+    void print(std::ostream &out);
+
+private:
+    std::chrono::steady_clock::time_point wall_start[NUM_OF_PHASES];
+    clock_t cpu_start[NUM_OF_PHASES];
+    double wall_time[NUM_OF_PHASES];
+    double cpu_time[NUM_OF_PHASES];
+    int64_t peak_memory[NUM_OF_PHASES];
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FLBWT_THREAD_POOL_HPP
+#define FLBWT_THREAD_POOL_HPP
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flbwt
+{
+
+/**
+ * @brief Fixed set of threads that run the same task together.
+ * Meant for phases that alternate short parallel steps with serial work,
+ * where starting new threads for every step would cost more than the step.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Construct a new ThreadPool object.
+     * 
+     * @param threads number of threads including the calling thread
+     */
+    ThreadPool(unsigned threads);
+
+    /**
+     * @brief Get the number of threads (including the calling thread).
+     * 
+     * @return unsigned number of threads
+     */
+    unsigned size();
+
+    /**
+     * @brief Run task(t) on every thread t = 0..size()-1 and wait for all of them.
+     * The calling thread runs task(0).
+     * 
+     * @param task task to be run
+     */
+    void run(const std::function<void(unsigned)> &task);
+
+    /**
+     * @brief Split [0, n) into size() contiguous ranges and run task(begin, end) for them.
+     * 
+     * @param n number of items
+     * @param task task to be run for a range
+     */
+    void parallel_for(uint64_t n, const std::function<void(uint64_t, uint64_t)> &task);
+
+    /**
+     * @brief Destroy the ThreadPool object (joins the threads).
+     */
+    ~ThreadPool();
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const std::function<void(unsigned)> *task;
+    uint64_t generation; // incremented for every run()
+    unsigned pending;    // workers still running the current task
+    bool stop;
+
+    void work(unsigned t);
+};
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef FLBWT_WORKSPACE_HPP
+#define FLBWT_WORKSPACE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+namespace flbwt
+{
+
+/**
+ * @brief Raw memory recycled between the phases of the BWT construction.
+ *
+ * The large buffers (S, T1 and the SA of T1) are taken from the workspace as
+ * arenas. When a phase is done with a buffer, it gives the arena back and a
+ * later phase takes it again: whole (the SA arena becomes the BWT) or in pieces
+ * (the induce queue slabs). Arenas are only returned to the heap when the
+ * workspace is destroyed, so the peak does not depend on whether malloc hands
+ * freed memory out again.
+ *
+ * Arenas are allocated with new[] and counted by memory.hpp.
+ */
+class Workspace
+{
+public:
+    /**
+     * @brief Construct a new empty Workspace object.
+     */
+    Workspace();
+
+    /**
+     * @brief Take a whole arena: the smallest given back arena that fits and has no
+     * pieces carved out of it, otherwise a new one. Throws std::bad_alloc if the
+     * allocation fails.
+     * 
+     * @param bytes minimum size of the arena
+     * @return void* arena
+     */
+    void *acquire(uint64_t bytes);
+
+    /**
+     * @brief Give an arena back for the later phases.
+     * 
+     * @param arena arena from acquire (NULL is ignored)
+     */
+    void release(void *arena);
+
+    /**
+     * @brief Carve a piece out of the given back arenas. The piece stays valid
+     * until the workspace is destroyed (it can't be given back on its own).
+     * 
+     * @param bytes size of the piece (rounded up to 8 bytes)
+     * @return void* piece or NULL if no given back arena has room for it
+     */
+    void *carve(uint64_t bytes);
+
+    /**
+     * @brief Check whether carve would succeed.
+     * 
+     * @param bytes size of the piece
+     * @return true a given back arena has room for the piece
+     * @return false carve would return NULL
+     */
+    bool can_carve(uint64_t bytes);
+
+    /**
+     * @brief Hand an arena over to the caller as a new[] buffer (release with delete[]).
+     * Only the first bytes of it are counted from now on.
+     * 
+     * @param arena arena from acquire
+     * @param bytes counted size of the buffer
+     * @return uint8_t* buffer
+     */
+    uint8_t *detach(void *arena, uint64_t bytes);
+
+    /**
+     * @brief Get the total size of the arenas owned by the workspace.
+     * 
+     * @return uint64_t bytes
+     */
+    uint64_t get_size();
+
+    /**
+     * @brief Destroy the Workspace object (frees every arena that was not detached).
+     */
+    ~Workspace();
+
+private:
+    struct Arena
+    {
+        uint8_t *p;      // memory of the arena
+        uint64_t bytes;  // size of the arena
+        uint64_t carved; // bytes carved from the end of the arena
+        bool in_use;     // taken with acquire and not given back
+    };
+
+    std::vector<Arena> arenas;
+
+    /**
+     * @brief Find the arena starting at p (throws std::invalid_argument if there is none).
+     */
+    uint64_t find(void *p);
+};
+
+}
+
+#endif
@@ -7,6 +7,9 @@ flbwt::Container::Container(uint64_t n)
     this->num_of_substrings = 0;
     this->n = n;
     this->num_of_unique_substrings = 0;
+    this->occurrences = NULL;
+    this->num_of_occurrence_queues = 0;
+    this->ordinal_names = NULL;
 
     for (int i = 256 + 2; i--;)
     {
@@ -23,4 +26,20 @@ flbwt::Container::~Container()
 {
     delete this->hashtable;
     this->hashtable = NULL;
+
+    this->release_occurrences();
+}
+
+void flbwt::Container::release_occurrences()
+{
+    if (this->occurrences != NULL)
+    {
+        for (uint64_t i = 0; i < this->num_of_occurrence_queues; i++)
+            delete this->occurrences[i];
+        delete[] this->occurrences;
+        this->occurrences = NULL;
+    }
+
+    delete this->ordinal_names;
+    this->ordinal_names = NULL;
 }
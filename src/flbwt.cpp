@@ -1,18 +1,25 @@
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
-// #include <time.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "flbwt.hpp"
+#include "memory.hpp"
+#include "queue.hpp"
 #include "utility.hpp"
-#include "induce40bit.hpp"
-#include "induce48bit.hpp"
-#include "induce56bit.hpp"
-#include "induce64bit.hpp"
-#include "sais32bit.hpp"
-#include "sais40bit.hpp"
-#include "sais48bit.hpp"
-#include "sais56bit.hpp"
-#include "sais64bit.hpp"
+#include "induce.hpp"
+#include "sais.hpp"
 
 /**
  * @brief Algorithm 1 from the research paper (simplified version).
@@ -20,16 +27,149 @@
  * @param T input string
  * @param n input string length
  * @param free_T should the input string be freed
+ * @param mapped_length length of the memory mapping holding T (0 if T was allocated with malloc)
+ * @param open_output called once the memory limit is known to be met, returns a buffer of n bytes
+ *        for the BWT without the sentinel slot (empty function or NULL --> n + 1 bytes allocated with new[])
+ * @param options construction options
  * @return flbwt::BWT_result* result
  */
-flbwt::BWT_result *bwt_is(uint8_t *T, const uint64_t n, bool free_T);
+flbwt::BWT_result *bwt_is(uint8_t *T, const uint64_t n, bool free_T, uint64_t mapped_length,
+                          const std::function<uint8_t *()> &open_output, const flbwt::BWT_options &options);
 
-void flbwt::bwt_file(const char *input_filename, const char *output_filename)
+/**
+ * @brief Map the input file into memory. The mapping is followed by
+ * zero-filled memory, so that T[n] == '\0' like with the malloc'd input.
+ * 
+ * @param fd file descriptor of the input file
+ * @param n length of the input file
+ * @param mapped_length length of the created mapping (output)
+ * @return uint8_t* mapped input string or NULL if mapping failed
+ */
+static uint8_t *map_input_file(int fd, const uint64_t n, uint64_t &mapped_length)
+{
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    mapped_length = (n + 1 + page_size - 1) / page_size * page_size;
+
+    // Reserve anonymous (zero) pages first. If n is a multiple of the page size,
+    // T[n] lands on the extra page, otherwise on the zero-filled tail of the file page.
+    void *area = mmap(NULL, mapped_length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+        return NULL;
+
+    void *T = mmap(area, n, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (T == MAP_FAILED)
+    {
+        munmap(area, mapped_length);
+        return NULL;
+    }
+
+    // Input is scanned linearly --> pages can be read ahead and dropped behind
+    madvise(T, n, MADV_SEQUENTIAL);
+
+    return (uint8_t *)T;
+}
+
+/**
+ * @brief Create the output file with space for the rank and the n BWT
+ * characters and map it into memory.
+ * 
+ * @param fd file descriptor of the output file (opened for reading and writing)
+ * @param n length of the input string
+ * @return uint8_t* mapped output file or NULL if mapping failed
+ */
+static uint8_t *map_output_file(int fd, const uint64_t n)
+{
+    uint64_t length = 8 + n;
+
+    // Reserve the disk blocks up front --> running out of space fails here and not on page write-back
+    if (posix_fallocate(fd, 0, length) != 0)
+        return NULL;
+
+    void *out = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (out == MAP_FAILED)
+        return NULL;
+
+    return (uint8_t *)out;
+}
+
+/**
+ * @brief Write rank of the last character as 64-bit big-endian integer.
+ * 
+ * @param out destination (8 bytes)
+ * @param last rank of the last character
+ */
+static void write_rank(uint8_t *out, const uint64_t last)
+{
+    out[0] = (0xff00000000000000 & last) >> 56;
+    out[1] = (0x00ff000000000000 & last) >> 48;
+    out[2] = (0x0000ff0000000000 & last) >> 40;
+    out[3] = (0x000000ff00000000 & last) >> 32;
+    out[4] = (0x00000000ff000000 & last) >> 24;
+    out[5] = (0x0000000000ff0000 & last) >> 16;
+    out[6] = (0x000000000000ff00 & last) >> 8;
+    out[7] = 0x00000000000000ff & last;
+}
+
+/**
+ * @brief Start timing the phase if statistics are collected.
+ * 
+ * @param stats statistics or NULL
+ * @param phase phase
+ */
+static void start_phase(flbwt::Stats *stats, flbwt::Phase phase)
+{
+    if (stats != NULL)
+        stats->start(phase);
+}
+
+/**
+ * @brief Stop timing the phase if statistics are collected.
+ * 
+ * @param stats statistics or NULL
+ * @param phase phase
+ */
+static void stop_phase(flbwt::Stats *stats, flbwt::Phase phase)
+{
+    if (stats != NULL)
+        stats->stop(phase);
+}
+
+/**
+ * @brief Release the input string.
+ * 
+ * @param T input string
+ * @param mapped_length length of the memory mapping holding T (0 if T was allocated with malloc)
+ */
+static void release_input(uint8_t *T, const uint64_t mapped_length)
+{
+    if (mapped_length != 0)
+        munmap(T, mapped_length); // releases the mapped input pages
+    else
+        free(T);
+}
+
+flbwt::BWT_options::BWT_options()
+{
+    this->mmap_input = true;
+    this->mmap_output = true;
+    this->threads = 1;
+    this->hash_type = flbwt::HASH_WORD;
+    this->record_occurrences = true;
+    this->sa_layout = flbwt::SA_LAYOUT_SPLIT;
+    this->min_sa_bits = 0;
+    this->stats = NULL;
+    this->scratch_dir = NULL;
+    this->ram_budget = 0;
+    this->max_memory = 0;
+}
+
+void flbwt::bwt_file(const char *input_filename, const char *output_filename, const flbwt::BWT_options &options)
 {
     // Read content from the input file
     FILE *fp = fopen(input_filename, "r"); // file I/O stream
     uint64_t n;                            // length of the file content
-    uint8_t *T;                            // file content string
+    uint8_t *T = NULL;                     // file content string
+    uint64_t mapped_length = 0;            // length of the input mapping (0 if not mapped)
 
     if (fp == NULL)
         throw std::invalid_argument("fopen failed(): Could not open input file");
@@ -38,276 +178,549 @@ void flbwt::bwt_file(const char *input_filename, const char *output_filename)
     n = ftell(fp);
     rewind(fp);
 
-    T = (uint8_t *)malloc((n + 1) * sizeof(uint8_t));
-
-    if (!T)
+    if (n == 0)
     {
         fclose(fp);
-        throw std::runtime_error("T* malloc failed(): Could not allocate memory");
+        throw std::runtime_error("fread failed(): Could not read input file");
+    }
+
+    if (options.mmap_input)
+        T = map_input_file(fileno(fp), n, mapped_length);
+
+    if (T == NULL)
+    { // Mapping not requested or not possible --> read the whole file
+        mapped_length = 0;
+        T = (uint8_t *)malloc((n + 1) * sizeof(uint8_t));
+
+        if (!T)
+        {
+            fclose(fp);
+            throw std::runtime_error("T* malloc failed(): Could not allocate memory");
+        }
+
+        if (fread(T, 1, n, fp) <= 0)
+            throw std::runtime_error("fread failed(): Could not read input file");
+
+        // Input string should end with '\0' --> so the following assignment is ok.
+        T[n] = '\0';
     }
 
-    if (fread(T, 1, n, fp) <= 0)
-        throw std::runtime_error("fread failed(): Could not read input file");
     fclose(fp);
 
-    // Input string should end with '\0' --> so the following assignment is ok.
-    T[n] = '\0';
+    // Open the output file (mapped output needs read access as well). bwt_is opens it only
+    // after checking the memory limit --> an existing file is not truncated if that fails.
+    int out_fd = -1;
+    uint8_t *out = NULL;
+    bool created = false;
+    std::function<uint8_t *()> open_output;
+
+    if (options.mmap_output)
+    {
+        open_output = [&]() -> uint8_t * {
+            out_fd = open(output_filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+            if (out_fd == -1)
+                throw std::invalid_argument("open failed(): Could not open output file");
+
+            created = true;
+            out = map_output_file(out_fd, n);
 
-    // Construct the bwt for input string
-    // clock_t begin = clock();
-    flbwt::BWT_result *B = flbwt::bwt_string(T, n, true);
-    // clock_t end = clock();
-    // std::cout << "Running time: " << ((double)(end - begin) / CLOCKS_PER_SEC) << std::endl;
+            if (out == NULL)
+            { // Mapping not possible --> fall back to writing from the heap buffer
+                close(out_fd);
+                out_fd = -1;
+                return NULL;
+            }
+
+            return out + 8;
+        };
+    }
+
+    // Construct the bwt for input string (a partially written output file is removed on failure)
+    flbwt::BWT_result *B = NULL;
+
+    try
+    {
+        B = bwt_is(T, n, true, mapped_length, open_output, options);
+    }
+    catch (...)
+    {
+        if (out != NULL)
+            munmap(out, 8 + n);
+        if (out_fd != -1)
+            close(out_fd);
+        if (created)
+            unlink(output_filename);
+        throw;
+    }
+
+    start_phase(options.stats, flbwt::PHASE_WRITE);
+
+    if (out != NULL)
+    {
+        // BWT was induced directly into the output file (without the sentinel) --> write the rank
+        write_rank(out, B->last);
+
+        munmap(out, 8 + n);
+        close(out_fd);
+
+        free(B);
+        stop_phase(options.stats, flbwt::PHASE_WRITE);
+        return;
+    }
 
     // Write the bwt to the output file */
-    fp = fopen(output_filename, "wb");
+    FILE *fp_out = fopen(output_filename, "wb");
 
-    if (fp == NULL)
+    if (fp_out == NULL)
         throw std::invalid_argument("fopen failed(): Could not open output file");
 
     if (B != NULL && B->BWT != NULL)
     {
         // Write rank of the last character to the first 64 bits
-        uint8_t *rank = new uint8_t[8];
-        rank[0] = (0xff00000000000000 & B->last) >> 56;
-        rank[1] = (0x00ff000000000000 & B->last) >> 48;
-        rank[2] = (0x0000ff0000000000 & B->last) >> 40;
-        rank[3] = (0x000000ff00000000 & B->last) >> 32;
-        rank[4] = (0x00000000ff000000 & B->last) >> 24;
-        rank[5] = (0x0000000000ff0000 & B->last) >> 16;
-        rank[6] = (0x000000000000ff00 & B->last) >> 8;
-        rank[7] = 0x00000000000000ff & B->last;
-        fwrite(rank, sizeof(uint8_t), 8, fp);
-        delete[] rank;
+        uint8_t rank[8];
+        write_rank(rank, B->last);
+        fwrite(rank, sizeof(uint8_t), 8, fp_out);
 
         // Write other content (BWT)
         if (B->last == 0)
         {
-            fwrite(B->BWT + 1, sizeof(uint8_t), n, fp);
+            fwrite(B->BWT + 1, sizeof(uint8_t), n, fp_out);
         }
         else if (B->last == n)
         {
-            fwrite(B->BWT, sizeof(uint8_t), n, fp);
+            fwrite(B->BWT, sizeof(uint8_t), n, fp_out);
         }
         else
         {
-            fwrite(B->BWT, sizeof(uint8_t), B->last, fp);
-            fwrite(B->BWT + B->last + 1, sizeof(uint8_t), n - B->last, fp);
+            fwrite(B->BWT, sizeof(uint8_t), B->last, fp_out);
+            fwrite(B->BWT + B->last + 1, sizeof(uint8_t), n - B->last, fp_out);
         }
     }
 
-    fclose(fp);
+    fclose(fp_out);
+    stop_phase(options.stats, flbwt::PHASE_WRITE);
 
     // Release result resources
     if (B != NULL)
     {
         if (B->BWT != NULL)
+        {
             delete[] B->BWT;
+            flbwt::mem_untrack(n + 1);
+        }
         free(B);
     }
 }
 
-flbwt::BWT_result *flbwt::bwt_string(uint8_t *T, const uint64_t n, bool free_T)
+flbwt::BWT_result *flbwt::bwt_string(uint8_t *T, const uint64_t n, bool free_T, const flbwt::BWT_options &options)
 {
     // Check that input string is not NULL and length is greater than 0
     if (T == NULL || n <= 0)
         throw std::invalid_argument("bwt_string failed(): Invalid parameters");
 
     // Call the bwt construction with induced sorting
-    return bwt_is(T, n, free_T);
+    flbwt::BWT_result *B = bwt_is(T, n, free_T, 0, std::function<uint8_t *()>(), options);
+
+    // The BWT buffer is owned by the caller from now on
+    flbwt::mem_untrack(n + 1);
+
+    return B;
 }
 
-flbwt::BWT_result *bwt_is(uint8_t *T, const uint64_t n, bool free_T)
+/**
+ * @brief Suffix sort T1 and induce the BWT of the original string from it.
+ * The arenas of T1 and S are given back to the workspace before inducing.
+ * 
+ * @tparam Storage suffix array storage policy
+ * @param T1 shortened string (packed in an arena of the workspace)
+ * @param S sorted S* substrings (indexed by name, an arena of the workspace)
+ * @param container container
+ * @param BWT_buffer output buffer or NULL
+ * @param threads number of threads
+ * @param stats statistics or NULL
+ * @param pool pool of the induce queue blocks or NULL
+ * @param workspace workspace holding T1, S and SA
+ * @return flbwt::BWT_result* result
+ */
+template <class Storage>
+static flbwt::BWT_result *bwt_from_shortened_string(flbwt::PackedArray *T1, uint8_t **S, flbwt::Container *container,
+                                                    uint8_t *BWT_buffer, unsigned threads, flbwt::Stats *stats,
+                                                    flbwt::QueuePool *pool, flbwt::Workspace *workspace)
 {
-    // Decompose the input string into S* substrings
-    flbwt::Container *container = flbwt::extract_LMS_strings(T, n);
+    uint64_t total_substring_count = container->num_of_substrings + 2;
+    uint64_t T1_length = container->num_of_substrings + 1;
+    uint64_t k = container->num_of_unique_substrings + 2;
 
-    // Sort the S*substrings and name them
-    uint8_t **S = flbwt::sort_LMS_strings(T, container);
+    if (stats != NULL)
+        stats->sa_bits = Storage::BITS;
 
-    // Get new shortened string T1
-    flbwt::PackedArray *T1 = flbwt::create_shortened_string(T, n, container);
+    // Compute SA
+    start_phase(stats, flbwt::PHASE_SAIS);
+    Storage SA = Storage::place(workspace->acquire(Storage::bytes(total_substring_count)), total_substring_count);
+    flbwt::sais(T1->get_raw_arr_pointer(), T1->get_integer_bits(), SA, 0, T1_length, k, threads);
 
-    // Release T if user allows it --> lower memory usage
-    if (free_T)
+    // Compute BWT for shortened string: replace each suffix by the last character
+    // of the S* substring preceding it (T1 value i is stored at packed index i + 1)
+    for (uint64_t i = 0; i < T1_length; i++)
     {
-        free(T);
-        T = NULL;
+        uint8_t *q = S[T1->get_value(SA.get(i))];
+        uint64_t l = container->hashtable->get_length(q);
+        SA.set(i, container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base);
     }
 
-    // Create a suffix array for T1
-    // Arrays of different sizes are used to store the SA
-    int8_t *SA_8bit = NULL;
-    int16_t *SA_16bit = NULL;
-    uint16_t *SA_u16bit = NULL;
-    int32_t *SA_32bit = NULL;
-    uint32_t *SA_u32bit = NULL;
-    int64_t *SA_64bit = NULL;
+    // Give the arenas that are no longer needed back (the induce queues are carved from them)
+    workspace->release(S);
+    workspace->release(T1->get_raw_arr_pointer());
+    delete T1;
+    stop_phase(stats, flbwt::PHASE_SAIS);
 
-    uint64_t total_substring_count = container->num_of_substrings + 2;
-    uint64_t max_value = container->sa_max_value;
-    if (total_substring_count > max_value)
-        max_value = total_substring_count;
-
-    uint8_t bits = flbwt::position_of_msb(max_value);
-    uint64_t T1_length = container->num_of_substrings + 1;
-    uint64_t k = container->num_of_unique_substrings + 2;
+    // Create BWT for the original input string T (the SA arena is given back in this function)
+    start_phase(stats, flbwt::PHASE_INDUCE);
+    flbwt::BWT_result *BWT = flbwt::induce_bwt(SA, container, BWT_buffer, threads, stats, pool, workspace);
+    stop_phase(stats, flbwt::PHASE_INDUCE);
 
-    flbwt::BWT_result *BWT = NULL;
+    return BWT;
+}
 
-    uint64_t l;
-    uint8_t *q;
-    uint64_t p;
+#define PLAN_THREAD_BYTES (1 << 20) // working buffers of a thread in the parallel SA-IS and induce (estimate)
+#define PLAN_MIN_QUEUE_BLOCK 64     // plan_memory does not shrink the induce queue blocks further
 
+/**
+ * @brief Get the width of the SA storage chosen for values of the given width.
+ */
+static uint8_t sa_storage_bits(uint8_t bits)
+{
     if (bits < 32U)
-    { // SA can be stored into array of 32 bit integers
+        return 32;
+    if (bits >= 56U)
+        return 64;
+    return (bits + 8) / 8 * 8;
+}
 
-        // Compute SA
-        SA_32bit = new int32_t[total_substring_count];
-        flbwt::sais_32bit((uint8_t *)T1->get_raw_arr_pointer(), SA_32bit, 0, T1_length, k, T1->get_integer_bits());
+/**
+ * @brief Get the bytes of queue blocks holding count values.
+ */
+static uint64_t queue_bytes(uint64_t count, uint64_t block_size, uint8_t w)
+{
+    uint64_t blocks = (count + block_size - 1) / block_size;
+    return blocks * (sizeof(flbwt::qblock) + flbwt::PackedArray::words_required(block_size, w) * sizeof(uint64_t));
+}
 
-        // Compute BWT for shortened string
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; ++i)
-            ++SA_32bit[i];
+/**
+ * @brief Get the bytes of the partially filled induce queue blocks: two for each
+ * queue of an occurring character and the rest of a slab.
+ */
+static uint64_t queue_slack(flbwt::Container *container, uint64_t block_size)
+{
+    uint64_t active = 0;
+    for (uint64_t c = 0; c <= 256 + 1; c++)
+        active += (container->M[c] > 0);
 
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; i++)
-        {
-            p = SA_32bit[i];
-            q = S[T1->get_value(p - 1)];
-            l = container->hashtable->get_length(q);
-            uint64_t value = container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base;
-            SA_32bit[i] = value;
-        }
+    return (2 * 3 * active + QSLAB_BLOCKS) * queue_bytes(1, block_size, container->bwp_width);
+}
 
-        // Release resources that are no longer needed
-        free(S);
-        delete T1;
+/**
+ * @brief Estimate the peak of every phase for the strategy of the plan.
+ * 
+ * @param plan plan (strategy in, estimates out)
+ * @param container container (after sort_LMS_strings)
+ * @param base heap in use after sort_LMS_strings
+ * @param occurrence_bytes heap of the recorded occurrences (included in base)
+ * @param T_bytes bytes of T on the heap
+ * @param free_T T can be released
+ * @param BWT_buffered the BWT is written to a buffer given by the caller
+ * @param sa_bits width of the SA storage
+ */
+static void estimate_phases(flbwt::Memory_plan &plan, flbwt::Container *container, uint64_t base,
+                            uint64_t occurrence_bytes, uint64_t T_bytes, bool free_T, bool BWT_buffered,
+                            uint8_t sa_bits)
+{
+    uint64_t total = container->num_of_substrings + 2;
+    uint64_t k = container->num_of_unique_substrings + 2;
+    uint64_t T1_bytes = flbwt::PackedArray::words_required(total, flbwt::position_of_msb(k - 1)) * sizeof(uint64_t);
+    uint64_t SA_bytes = total * sa_bits / 8;
+    uint64_t S_bytes = k * sizeof(uint8_t *);
+    uint64_t keys_bytes = (k - 1) * (2 * sizeof(uint8_t *) + sizeof(uint64_t)); // LMS_key array of the sort
+    uint64_t BWT_bytes = BWT_buffered ? 0 : container->n + 1;
+
+    // The workspace keeps the arenas of S and the sort keys (both in base) until the end.
+    // T1 and SA reuse the keys arena if they fit in it, the BWT reuses the SA arena.
+    bool T1_in_keys = (T1_bytes <= keys_bytes);
+    uint64_t T1_new = T1_in_keys ? 0 : T1_bytes;
+    uint64_t SA_new = (!T1_in_keys && SA_bytes <= keys_bytes) ? 0 : SA_bytes;
+    uint64_t BWT_new = (BWT_bytes > std::max(SA_bytes, SA_new ? 0 : keys_bytes)) ? BWT_bytes : 0;
+
+    // T is needed by create_shortened_string unless the occurrences are used, later only if it can't be released
+    uint64_t T_shorten = (plan.keep_T || !free_T) ? T_bytes : 0;
+    uint64_t T_after = free_T ? 0 : T_bytes;
+
+    // the occurrences are released before (keep_T) or while T1 is built
+    uint64_t after_shorten = base - occurrence_bytes;
+
+    // SA-IS: bucket array, with threads also the bit vector of the S* positions and their buffers
+    uint64_t sais_bytes = k * sa_bits / 8;
+    if (plan.threads > 1)
+        sais_bytes += total / 8 + plan.threads * PLAN_THREAD_BYTES;
+
+    // induce: all S* suffixes are queued before SA is released and the BWT allocated.
+    // The filled blocks of the in-memory queues come on top of the partial ones, the
+    // arenas of S, the keys and T1 are carved first (whole slabs only). Spilling queues
+    // fill the carved slabs before spilling --> the partial blocks come from the heap.
+    uint64_t queued = queue_slack(container, plan.queue_block_size);
+
+    if (!plan.spill_queues)
+    {
+        uint64_t slab = sizeof(uint64_t) + QSLAB_BLOCKS * queue_bytes(1, plan.queue_block_size, container->bwp_width);
+        uint64_t carved = (S_bytes / slab + keys_bytes / slab + T1_new / slab) * slab;
 
-        // Create BWT for the original input string T (SA_32bit is deleted in this function)
-        BWT = flbwt::induce_bwt_32bit(SA_32bit, container);
+        queued += queue_bytes(total, plan.queue_block_size, container->bwp_width);
+        queued = (queued > carved) ? queued - carved : 0;
     }
-    else if (bits < 40U)
-    { // SA can be stored into two integer arrays (32 + 8 bits)
 
-        // Compute SA
-        SA_u32bit = new uint32_t[total_substring_count]; // first 32 bits
-        SA_8bit = new int8_t[total_substring_count];     // 8 most significant bits
-        flbwt::sais_40bit((uint8_t *)T1->get_raw_arr_pointer(), NULL, NULL, SA_u32bit, SA_8bit, 0, T1_length, k, T1->get_integer_bits());
+    uint64_t induce_bytes = (plan.threads > 1) ? plan.threads * PLAN_THREAD_BYTES : 0;
 
-        // Compute BWT for shortened string
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; ++i)
-        {
-            int64_t tmp = flbwt::get_40bit_value(SA_u32bit, SA_8bit, i);
-            flbwt::set_40bit_value(SA_u32bit, SA_8bit, i, tmp + 1);
-        }
+    plan.phase_bytes[flbwt::PHASE_EXTRACT] = base + T_bytes;
+    plan.phase_bytes[flbwt::PHASE_SORT] = base + T_bytes;
+    plan.phase_bytes[flbwt::PHASE_SHORTEN] = (plan.keep_T ? after_shorten : base) + T1_new + T_shorten;
+    plan.phase_bytes[flbwt::PHASE_SAIS] = after_shorten + T1_new + SA_new + sais_bytes + T_after;
+    plan.phase_bytes[flbwt::PHASE_INDUCE] = after_shorten + T1_new + SA_new + BWT_new + queued + induce_bytes +
+                                            T_after;
+    plan.phase_bytes[flbwt::PHASE_WRITE] = BWT_bytes + T_after;
+
+    plan.peak_bytes = 0;
+    plan.peak_phase = flbwt::PHASE_EXTRACT;
 
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; i++)
+    for (int i = 0; i < flbwt::NUM_OF_PHASES; i++)
+    {
+        if (plan.phase_bytes[i] > plan.peak_bytes)
         {
-            p = flbwt::get_40bit_value(SA_u32bit, SA_8bit, i);
-            q = S[T1->get_value(p - 1)];
-            l = container->hashtable->get_length(q);
-            uint64_t value = container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base;
-            flbwt::set_40bit_value(SA_u32bit, SA_8bit, i, value);
+            plan.peak_bytes = plan.phase_bytes[i];
+            plan.peak_phase = (flbwt::Phase)i;
         }
+    }
+}
 
-        // Release resources that are no longer needed
-        free(S);
-        delete T1;
+flbwt::Memory_plan flbwt::plan_memory(flbwt::Container *container, uint64_t max_memory, uint64_t T_bytes, bool free_T,
+                                      bool BWT_buffered, uint8_t sa_bits, const flbwt::BWT_options &options)
+{
+    // heap in use now and the part of it taken by the recorded occurrences
+    int64_t current = flbwt::mem_current();
+    uint64_t base = (current > 0) ? current : 0;
+    uint64_t occurrence_bytes = 0;
 
-        // Create BWT for the original input string T (SA_u32bit and SA_8bit are deleted in this function)
-        BWT = flbwt::induce_bwt_40bit(SA_u32bit, SA_8bit, container);
+    for (uint64_t t = 0; container->occurrences != NULL && t < container->num_of_occurrence_queues; t++)
+    {
+        flbwt::QueuePool *pool = container->occurrences[t]->get_pool();
+        occurrence_bytes += queue_bytes(pool->get_num_of_blocks() * pool->get_block_size(), pool->get_block_size(),
+                                        pool->get_width());
     }
-    else if (bits < 48U)
-    { // SA can be stored into two integer arrays (32 + 16 bits)
 
-        // Compute SA
-        SA_u32bit = new uint32_t[total_substring_count]; // first 32 bits
-        SA_16bit = new int16_t[total_substring_count];   // 16 most significant bits
-        flbwt::sais_48bit((uint8_t *)T1->get_raw_arr_pointer(), NULL, NULL, SA_u32bit, SA_16bit, 0, T1_length, k, T1->get_integer_bits());
+    if (container->ordinal_names != NULL)
+        occurrence_bytes += flbwt::PackedArray::words_required(container->ordinal_names->get_length(),
+                                                               container->ordinal_names->get_integer_bits()) *
+                            sizeof(uint64_t);
 
-        // Compute BWT for shortened string
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; ++i)
-        {
-            int64_t tmp = flbwt::get_48bit_value(SA_u32bit, SA_16bit, i);
-            flbwt::set_48bit_value(SA_u32bit, SA_16bit, i, tmp + 1);
-        }
+    if (occurrence_bytes > base)
+        occurrence_bytes = base;
+
+    flbwt::Memory_plan plan;
+    plan.keep_T = (container->occurrences == NULL);
+    plan.spill_queues = (options.scratch_dir != NULL);
+    plan.ram_budget = options.ram_budget;
+    plan.queue_block_size = QSIZ;
+    plan.threads = options.threads;
+    estimate_phases(plan, container, base, occurrence_bytes, T_bytes, free_T, BWT_buffered, sa_bits);
+
+    // Apply the first change (cheapest first) that lowers the estimated peak until it fits
+    while (max_memory != 0 && plan.peak_bytes > max_memory)
+    {
+        flbwt::Memory_plan alternatives[4] = {plan, plan, plan, plan};
+        alternatives[0].keep_T = true;       // rehash T instead of keeping the occurrences
+        alternatives[1].spill_queues = true; // spill the induce queues to a scratch file
+        alternatives[2].threads = 1;         // drop the buffers of the threads
+        alternatives[3].queue_block_size = std::max<uint64_t>(plan.queue_block_size / 2, PLAN_MIN_QUEUE_BLOCK);
+
+        bool lowered = false;
 
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; i++)
+        for (int i = 0; i < 4 && !lowered; i++)
         {
-            p = flbwt::get_48bit_value(SA_u32bit, SA_16bit, i);
-            q = S[T1->get_value(p - 1)];
-            l = container->hashtable->get_length(q);
-            uint64_t value = container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base;
-            flbwt::set_48bit_value(SA_u32bit, SA_16bit, i, value);
+            estimate_phases(alternatives[i], container, base, occurrence_bytes, T_bytes, free_T, BWT_buffered, sa_bits);
+
+            if (alternatives[i].peak_bytes < plan.peak_bytes)
+            {
+                plan = alternatives[i];
+                lowered = true;
+            }
         }
 
-        // Release resources that are no longer needed
-        free(S);
-        delete T1;
+        if (!lowered)
+            break;
+    }
+
+    // the spilling queues leave room for the blocks they can't spill and a resident T
+    if (max_memory != 0)
+    {
+        uint64_t reserved = queue_slack(container, plan.queue_block_size) + (free_T ? 0 : T_bytes);
+        plan.ram_budget = (max_memory > reserved) ? max_memory - reserved : 0;
+    }
+
+    return plan;
+}
+
+flbwt::BWT_result *bwt_is(uint8_t *T, const uint64_t n, bool free_T, uint64_t mapped_length,
+                          const std::function<uint8_t *()> &open_output, const flbwt::BWT_options &options)
+{
+    flbwt::Stats *stats = options.stats;
+
+    // The recorded occurrences take a queue entry per S* substring --> the queue
+    // spilling mode rehashes T (mapped from the input file by bwt_file) instead
+    bool record_occurrences = options.record_occurrences && options.scratch_dir == NULL;
+
+    // Decompose the input string into S* substrings
+    start_phase(stats, flbwt::PHASE_EXTRACT);
+    flbwt::Container *container = flbwt::extract_LMS_strings(T, n, options.threads, options.hash_type,
+                                                              record_occurrences);
+    stop_phase(stats, flbwt::PHASE_EXTRACT);
+
+    // S, T1 and SA are arenas of the workspace, which recycles them in the later phases
+    // (the SA arena becomes the BWT, the others hold the induce queues)
+    flbwt::Workspace workspace;
+
+    // Sort the S*substrings and name them
+    start_phase(stats, flbwt::PHASE_SORT);
+    uint8_t **S = flbwt::sort_LMS_strings(T, container, options.threads, &workspace);
+    stop_phase(stats, flbwt::PHASE_SORT);
+
+    if (stats != NULL)
+    {
+        stats->num_of_substrings = container->num_of_substrings;
+        stats->num_of_unique_substrings = container->num_of_unique_substrings;
+        stats->hash_collisions = container->hashtable->collisions;
+        stats->queue_blocks = 0;
+        stats->spilled_blocks = 0;
+
+        for (uint64_t t = 0; container->occurrences != NULL && t < container->num_of_occurrence_queues; t++)
+            stats->queue_blocks += container->occurrences[t]->get_pool()->get_num_of_blocks();
+    }
+
+    // The SA storage for T1 is the narrowest one that can hold every value
+    uint64_t total_substring_count = container->num_of_substrings + 2;
+    uint64_t max_value = container->sa_max_value;
+    if (total_substring_count > max_value)
+        max_value = total_substring_count;
+
+    uint8_t bits = flbwt::position_of_msb(max_value);
+    if (bits < options.min_sa_bits)
+        bits = options.min_sa_bits;
 
-        // Create BWT for the original input string T (SA_u32bit and SA_16bit are deleted in this function)
-        BWT = flbwt::induce_bwt_48bit(SA_u32bit, SA_16bit, container);
+    // Choose the strategy of the remaining phases for the memory limit
+    uint64_t T_bytes = (mapped_length == 0) ? n + 1 : 0; // mapped input is not counted
+    flbwt::Memory_plan plan = flbwt::plan_memory(container, options.max_memory, T_bytes, free_T, (bool)open_output,
+                                                 sa_storage_bits(bits), options);
+
+    // Only the induce queues spill --> the SA of T1 has to fit in memory on its own
+    uint64_t SA_bytes = total_substring_count * sa_storage_bits(bits) / 8;
+
+    if (options.max_memory != 0 && plan.peak_bytes > options.max_memory)
+    {
+        delete container;
+        if (free_T)
+            release_input(T, mapped_length);
+
+        throw std::runtime_error("bwt_is failed(): Estimated peak memory is " + std::to_string(plan.peak_bytes) +
+                                 " bytes (" + flbwt::Stats::get_phase_name(plan.peak_phase) +
+                                 " phase), but max_memory is " + std::to_string(options.max_memory) +
+                                 " bytes (the suffix array of T1 takes " + std::to_string(SA_bytes) +
+                                 " bytes and can't be spilled)");
     }
-    else if (bits < 56U)
-    { // SA can be stored into three integer arrays (32 + 16 + 8bits)
 
-        // Compute SA
-        SA_u32bit = new uint32_t[total_substring_count]; // first 32 bits
-        SA_u16bit = new uint16_t[total_substring_count]; // 16 middle bits
-        SA_8bit = new int8_t[total_substring_count];     // 8 most significant bits
-        flbwt::sais_56bit((uint8_t *)T1->get_raw_arr_pointer(), NULL, NULL, NULL, SA_u32bit, SA_u16bit, SA_8bit, 0, T1_length, k, T1->get_integer_bits());
+    if (options.scratch_dir != NULL && options.ram_budget != 0 && SA_bytes > options.ram_budget)
+    {
+        delete container;
+        if (free_T)
+            release_input(T, mapped_length);
+
+        throw std::runtime_error("bwt_is failed(): The suffix array of T1 takes " + std::to_string(SA_bytes) +
+                                 " bytes and stays in memory (only the induce queues spill), but ram_budget is " +
+                                 std::to_string(options.ram_budget) + " bytes");
+    }
 
-        // Compute BWT for shortened string
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; ++i)
+    // The limit is met --> the output can be created (NULL --> the BWT is allocated with new[])
+    uint8_t *BWT_buffer = NULL;
+
+    if (open_output)
+    {
+        try
         {
-            int64_t tmp = flbwt::get_56bit_value(SA_u32bit, SA_u16bit, SA_8bit, i);
-            flbwt::set_56bit_value(SA_u32bit, SA_u16bit, SA_8bit, i, tmp + 1);
+            BWT_buffer = open_output();
         }
-
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; i++)
+        catch (...)
         {
-            p = flbwt::get_56bit_value(SA_u32bit, SA_u16bit, SA_8bit, i);
-            q = S[T1->get_value(p - 1)];
-            l = container->hashtable->get_length(q);
-            uint64_t value = container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base;
-            flbwt::set_56bit_value(SA_u32bit, SA_u16bit, SA_8bit, i, value);
+            delete container;
+            if (free_T)
+                release_input(T, mapped_length);
+            throw;
         }
+    }
 
-        // Release resources that are no longer needed
-        free(S);
-        delete T1;
+    // T1 is built by rehashing T --> the recorded occurrences are not needed
+    if (plan.keep_T)
+        container->release_occurrences();
 
-        // Create BWT for the original input string T (SA_u32bit, SA_u16bit and SA_8bit are deleted in this function)
-        BWT = flbwt::induce_bwt_56bit(SA_u32bit, SA_u16bit, SA_8bit, container);
+    // T1 is built from the recorded occurrences without reading T --> T can be released already
+    if (free_T && container->occurrences != NULL)
+    {
+        release_input(T, mapped_length);
+        T = NULL;
     }
-    else if (bits < 64)
-    { // SA can be stored into array of 64 bit integers
 
-        // Compute SA
-        SA_64bit = new int64_t[total_substring_count];
-        flbwt::sais_64bit((uint8_t *)T1->get_raw_arr_pointer(), SA_64bit, 0, T1_length, k, T1->get_integer_bits());
+    // Get new shortened string T1
+    start_phase(stats, flbwt::PHASE_SHORTEN);
+    flbwt::PackedArray *T1 = flbwt::create_shortened_string(T, n, container, &workspace);
+    stop_phase(stats, flbwt::PHASE_SHORTEN);
+
+    // Release T if user allows it --> lower memory usage
+    if (free_T && T != NULL)
+    {
+        release_input(T, mapped_length);
+        T = NULL;
+    }
 
-        // Compute BWT for shortened string
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; ++i)
-            ++SA_64bit[i];
+    // The induce queues share a pool of the planned block size. In the queue spilling
+    // mode the pool spills to a scratch file when the heap would grow over the budget.
+    flbwt::QueuePool *pool = new flbwt::QueuePool(container->bwp_width, plan.queue_block_size);
 
-        for (uint64_t i = 0; i < container->num_of_substrings + 1; i++)
-        {
-            p = SA_64bit[i];
-            q = S[T1->get_value(p - 1)];
-            l = container->hashtable->get_length(q);
-            uint64_t value = container->hashtable->get_first_character_pointer(q) + l - 1 - container->bwp_base;
-            SA_64bit[i] = value;
-        }
+    if (plan.spill_queues)
+        pool->set_scratch((options.scratch_dir != NULL) ? options.scratch_dir : P_tmpdir, plan.ram_budget);
+    pool->set_workspace(&workspace);
 
-        // Release resources that are no longer needed
-        free(S);
-        delete T1;
+    flbwt::BWT_result *BWT = NULL;
 
-        // Create BWT for the original input string T (SA_32bit is deleted in this function)
-        BWT = flbwt::induce_bwt_64bit(SA_64bit, container);
+    if (bits < 32U)
+        BWT = bwt_from_shortened_string<flbwt::SAStorage32>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+    else if (bits >= 56U)
+        BWT = bwt_from_shortened_string<flbwt::SAStorage64>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+    else if (options.sa_layout == flbwt::SA_LAYOUT_PACKED)
+    {
+        if (bits < 40U)
+            BWT = bwt_from_shortened_string<flbwt::SAStoragePacked40>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+        else if (bits < 48U)
+            BWT = bwt_from_shortened_string<flbwt::SAStoragePacked48>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+        else
+            BWT = bwt_from_shortened_string<flbwt::SAStoragePacked56>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+    }
+    else
+    {
+        if (bits < 40U)
+            BWT = bwt_from_shortened_string<flbwt::SAStorage40>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+        else if (bits < 48U)
+            BWT = bwt_from_shortened_string<flbwt::SAStorage48>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
+        else
+            BWT = bwt_from_shortened_string<flbwt::SAStorage56>(T1, S, container, BWT_buffer, plan.threads, stats, pool, &workspace);
     }
 
+    delete pool;
     delete container;
     return BWT;
 }
@@ -315,7 +728,179 @@ flbwt::BWT_result *bwt_is(uint8_t *T, const uint64_t n, bool free_T)
 #define TYPE_L 1
 #define TYPE_S 0
 
-flbwt::Container *flbwt::extract_LMS_strings(uint8_t *T, const uint64_t n)
+#define MIN_LMS_CHUNK 1024
+#define LMS_SHARDS_PER_THREAD 16
+
+/**
+ * @brief Part of the input string scanned by one thread in extract_LMS_strings.
+ * The chunk covers positions [begin, end) and owns the S* substrings starting
+ * in (begin, end]. All except the rightmost one of them are inserted to the shared
+ * (sharded) hashtable, because the end of the rightmost substring is in another chunk.
+ */
+struct LMS_chunk
+{
+    uint64_t begin;             // first position of the chunk
+    uint64_t end;               // position after the last position of the chunk
+    int end_type;               // type of the character T[end]
+    uint64_t first;             // leftmost S* position found in the chunk
+    uint64_t last;              // rightmost S* position found in the chunk
+    uint64_t num_of_substrings; // number of S* positions found in the chunk
+    uint64_t num_of_unique_substrings; // number of substrings that were new to the hashtable
+    flbwt::Queue *occurrences;  // ordinals of the substrings from right to left (NULL if not recorded)
+    uint64_t M[256 + 2];        // frequency of letter c
+    uint64_t C[256 + 2];        // number of S* substrings starting with character c
+    uint64_t NL[256 + 2];       // number of TYPE_L c-characters
+    flbwt::HashTable *hashtable;
+};
+
+/**
+ * @brief Scan one chunk of the input string from right to left
+ * (same as the serial loop in extract_LMS_strings).
+ */
+static void scan_LMS_chunk(uint8_t *T, const uint64_t n, LMS_chunk *chunk)
+{
+    int previous_type = chunk->end_type;
+    uint64_t p;
+    uint64_t q = 0;
+    uint64_t ordinal;
+
+    for (uint64_t i = chunk->end; i-- > chunk->begin;)
+    {
+        chunk->M[T[i] + 1]++;
+
+        if (T[i] < T[i + 1])
+        { // Character is TYPE_S
+            previous_type = TYPE_S;
+        }
+        else if (T[i] > T[i + 1])
+        { // Character is TYPE_L
+            if (previous_type == TYPE_S)
+            { // If previous character was TYPE_S, then new S* substring was found
+                p = i + 1;
+                ++chunk->C[T[p] + 1];
+
+                if (chunk->num_of_substrings++ == 0)
+                {
+                    chunk->last = p;
+                }
+                else
+                {
+                    chunk->num_of_unique_substrings += chunk->hashtable->insert_string(q - p + 1, &T[p], ordinal);
+                    if (chunk->occurrences != NULL)
+                        chunk->occurrences->enqueue(ordinal);
+                }
+
+                q = p;
+            }
+
+            previous_type = TYPE_L;
+            ++chunk->NL[T[i] + 1];
+        }
+        else
+        { // Same as previous character
+            if (previous_type == TYPE_L)
+                ++chunk->NL[T[i] + 1];
+        }
+    }
+
+    chunk->first = q;
+}
+
+/**
+ * @brief Parallel version of the S* substring extraction. The input string
+ * is split into chunks that are scanned concurrently, each chunk with its own
+ * histograms. Substrings are inserted concurrently to the sharded hashtable of
+ * the container. The results are merged into the container.
+ */
+static void extract_LMS_strings_parallel(uint8_t *T, const uint64_t n, unsigned threads,
+                                         bool record_occurrences, flbwt::Container *container)
+{
+    // Chunks cover positions [0, n - 1), the next to last character is handled by the caller
+    std::vector<LMS_chunk> chunks(threads);
+    uint64_t chunk_length = (n - 1) / threads;
+
+    for (unsigned t = 0; t < threads; t++)
+    {
+        LMS_chunk &chunk = chunks[t];
+        chunk.begin = t * chunk_length;
+        chunk.end = (t == threads - 1) ? n - 1 : (t + 1) * chunk_length;
+        chunk.first = chunk.last = 0;
+        chunk.num_of_substrings = 0;
+        chunk.num_of_unique_substrings = 0;
+        std::fill_n(chunk.M, 256 + 2, 0);
+        std::fill_n(chunk.C, 256 + 2, 0);
+        std::fill_n(chunk.NL, 256 + 2, 0);
+        chunk.hashtable = container->hashtable;
+        chunk.occurrences = NULL;
+    }
+
+    // Types at the chunk ends from right to left. A run of equal characters is scanned only
+    // up to the next chunk end, whose type is known by then --> every position is read once
+    // at most. The next to last character T[n - 1] is always of TYPE_L.
+    int type = TYPE_L;
+    for (unsigned t = threads; t-- > 0;)
+    {
+        uint64_t i = chunks[t].end;
+        uint64_t stop = (t == threads - 1) ? n - 1 : chunks[t + 1].end;
+
+        while (i < stop && T[i] == T[i + 1])
+            i++;
+
+        if (i < stop)
+            type = (T[i] < T[i + 1]) ? TYPE_S : TYPE_L;
+
+        chunks[t].end_type = type;
+    }
+
+    if (record_occurrences)
+    {
+        container->occurrences = new flbwt::Queue *[threads];
+        container->num_of_occurrence_queues = threads;
+        for (unsigned t = 0; t < threads; t++)
+            chunks[t].occurrences = container->occurrences[t] = new flbwt::Queue(flbwt::position_of_msb(n / 2 + 1));
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+        workers.push_back(std::thread(scan_LMS_chunk, T, n, &chunks[t]));
+    for (unsigned t = 0; t < threads; t++)
+        workers[t].join();
+
+    // Merge from right to left. The rightmost substring of each chunk ends
+    // at the leftmost S* position of the next chunk that has any.
+    uint64_t q = n;
+    for (unsigned t = threads; t-- > 0;)
+    {
+        LMS_chunk &chunk = chunks[t];
+
+        for (uint16_t c = 0; c < 256 + 2; c++)
+        {
+            container->M[c] += chunk.M[c];
+            container->C[c] += chunk.C[c];
+            container->NL[c] += chunk.NL[c];
+        }
+
+        if (chunk.num_of_substrings != 0)
+        {
+            container->num_of_substrings += chunk.num_of_substrings;
+            container->num_of_unique_substrings += chunk.num_of_unique_substrings;
+            uint64_t ordinal;
+            container->num_of_unique_substrings += container->hashtable->insert_string(q - chunk.last + 1, &T[chunk.last], ordinal);
+            if (chunk.occurrences != NULL)
+                chunk.occurrences->enqueue_l(ordinal); // rightmost substring of the chunk comes first
+            q = chunk.first;
+        }
+    }
+
+    // Later phases use the hashtable as a single buffer
+    container->hashtable->merge_shards();
+
+    // Save the ending position of head string
+    container->head_string_end = q;
+}
+
+flbwt::Container *flbwt::extract_LMS_strings(uint8_t *T, const uint64_t n, unsigned threads, flbwt::HashType hash_type,
+                                             bool record_occurrences)
 {
     // Initialize the result data structure
     flbwt::Container *container = new Container(n);
@@ -324,8 +909,35 @@ flbwt::Container *flbwt::extract_LMS_strings(uint8_t *T, const uint64_t n)
     if (n <= 2)
         return container;
 
+    // Use only as many threads as there are reasonably sized chunks
+    if (threads > (n - 1) / MIN_LMS_CHUNK)
+        threads = (n - 1) / MIN_LMS_CHUNK;
+
+    if (threads > 1)
+    {
+        // Initialize sharded hash table where unique substrings are stored
+        container->hashtable = new HashTable(HashTable::recommended_size(n), n, LMS_SHARDS_PER_THREAD * threads, hash_type);
+
+        ++container->M[0];
+        ++container->M[T[n - 1] + 1];
+        ++container->NL[T[n - 1] + 1];
+        ++container->C[0];
+        extract_LMS_strings_parallel(T, n, threads, record_occurrences, container);
+        return container;
+    }
+
     // Initialize hash table where unique substrings are stored
-    container->hashtable = new HashTable(67777, n);
+    container->hashtable = new HashTable(HashTable::recommended_size(n), n, 1, hash_type);
+
+    // Ordinals of the substrings in the order they are found (ordinal is at most n / 2)
+    flbwt::Queue *occurrences = NULL;
+    uint64_t ordinal;
+    if (record_occurrences)
+    {
+        container->occurrences = new flbwt::Queue *[1];
+        container->num_of_occurrence_queues = 1;
+        occurrences = container->occurrences[0] = new flbwt::Queue(flbwt::position_of_msb(n / 2 + 1));
+    }
 
     // The first S* substring is at location T[n] but it is ignored here.
     // The next to last character is always of TYPE_L.
@@ -356,9 +968,12 @@ flbwt::Container *flbwt::extract_LMS_strings(uint8_t *T, const uint64_t n)
                 ++container->num_of_substrings;
 
                 // insert unique substrings into hashtable
-                if (container->hashtable->insert_string(q - p + 1, &T[p]))
+                if (container->hashtable->insert_string(q - p + 1, &T[p], ordinal))
                     ++container->num_of_unique_substrings;
 
+                if (occurrences != NULL)
+                    occurrences->enqueue(ordinal);
+
                 q = p;
             }
 
@@ -378,10 +993,213 @@ flbwt::Container *flbwt::extract_LMS_strings(uint8_t *T, const uint64_t n)
     return container;
 }
 
-uint8_t **flbwt::sort_LMS_strings(uint8_t *T, flbwt::Container *container)
+/**
+ * @brief Sort key of an S* substring stored in the hashtable.
+ */
+struct LMS_key
+{
+    uint8_t *record; // position of the substring in hashtable
+    uint8_t *chars;  // first character of the substring
+    uint64_t length; // length of the substring
+};
+
+#define MKQS_INSERTION_SORT 16
+#define LMS_END 256
+
+/**
+ * @brief Character of the key at depth. Substrings are ordered so that if one
+ * substring is a prefix of another, the longer one comes first --> the end of
+ * a substring is larger than any character.
+ */
+static inline uint16_t key_character(const LMS_key &key, const uint64_t depth)
+{
+    return depth < key.length ? key.chars[depth] : LMS_END;
+}
+
+/**
+ * @brief Compare two keys starting from depth (true if a < b).
+ */
+static inline bool key_less(const LMS_key &a, const LMS_key &b, uint64_t depth)
+{
+    uint64_t l = std::min(a.length, b.length);
+
+    while (depth < l && a.chars[depth] == b.chars[depth])
+        depth++;
+
+    if (depth == l)
+        return a.length > b.length;
+    return a.chars[depth] < b.chars[depth];
+}
+
+/**
+ * @brief Three-way partition of the keys by the character at depth:
+ * [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot.
+ * 
+ * @return uint16_t pivot character
+ */
+static uint16_t partition_keys(LMS_key *keys, uint64_t n, uint64_t depth, uint64_t &lt, uint64_t &gt)
+{
+    // median of three as pivot
+    uint16_t a = key_character(keys[0], depth);
+    uint16_t b = key_character(keys[n / 2], depth);
+    uint16_t c = key_character(keys[n - 1], depth);
+    uint16_t pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+    lt = 0;
+    gt = n;
+    uint64_t i = 0;
+    while (i < gt)
+    {
+        uint16_t x = key_character(keys[i], depth);
+        if (x < pivot)
+            std::swap(keys[lt++], keys[i++]);
+        else if (x > pivot)
+            std::swap(keys[i], keys[--gt]);
+        else
+            i++;
+    }
+
+    return pivot;
+}
+
+/**
+ * @brief Multikey quicksort (Bentley & Sedgewick) for keys sharing the first depth characters.
+ * Recursion is used for the smaller and larger partitions, the equal partition continues
+ * in the loop with the next character.
+ */
+static void multikey_quicksort(LMS_key *keys, uint64_t n, uint64_t depth)
+{
+    uint64_t lt;
+    uint64_t gt;
+
+    while (n > MKQS_INSERTION_SORT)
+    {
+        uint16_t pivot = partition_keys(keys, n, depth, lt, gt);
+
+        multikey_quicksort(keys, lt, depth);
+        multikey_quicksort(keys + gt, n - gt, depth);
+
+        if (pivot == LMS_END) // equal substrings (can not happen with unique substrings)
+            return;
+
+        keys += lt;
+        n = gt - lt;
+        depth++;
+    }
+
+    // insertion sort for small partitions
+    for (uint64_t i = 1; i < n; i++)
+    {
+        LMS_key key = keys[i];
+        uint64_t j = i;
+        while (j > 0 && key_less(key, keys[j - 1], depth))
+        {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = key;
+    }
+}
+
+#define MKQS_PARALLEL_GRAIN 16384
+
+/**
+ * @brief Unsorted range of keys for parallel multikey quicksort.
+ */
+struct MKQS_task
+{
+    LMS_key *keys;  // first key of the range
+    uint64_t n;     // number of keys in the range
+    uint64_t depth; // keys share the first depth characters
+};
+
+/**
+ * @brief Shared stack of ranges waiting to be sorted.
+ */
+struct MKQS_tasks
+{
+    std::vector<MKQS_task> stack;
+    std::mutex lock;
+    std::condition_variable changed;
+    unsigned busy; // number of threads processing a task
+};
+
+/**
+ * @brief Worker of the parallel multikey quicksort. Large ranges are partitioned
+ * once and the partitions are pushed back to the stack, small ranges are sorted
+ * by the worker itself.
+ */
+static void multikey_quicksort_worker(MKQS_tasks *tasks)
+{
+    MKQS_task task;
+    uint64_t lt;
+    uint64_t gt;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(tasks->lock);
+            while (tasks->stack.empty() && tasks->busy != 0)
+                tasks->changed.wait(guard);
+
+            if (tasks->stack.empty()) // nothing left and nobody can create more
+                return;
+
+            task = tasks->stack.back();
+            tasks->stack.pop_back();
+            tasks->busy++;
+        }
+
+        if (task.n <= MKQS_PARALLEL_GRAIN)
+        {
+            multikey_quicksort(task.keys, task.n, task.depth);
+
+            std::lock_guard<std::mutex> guard(tasks->lock);
+            tasks->busy--;
+            tasks->changed.notify_all();
+            continue;
+        }
+
+        uint16_t pivot = partition_keys(task.keys, task.n, task.depth, lt, gt);
+
+        std::lock_guard<std::mutex> guard(tasks->lock);
+        MKQS_task smaller = {task.keys, lt, task.depth};
+        MKQS_task larger = {task.keys + gt, task.n - gt, task.depth};
+        MKQS_task equal = {task.keys + lt, gt - lt, task.depth + 1};
+        if (smaller.n > 1)
+            tasks->stack.push_back(smaller);
+        if (larger.n > 1)
+            tasks->stack.push_back(larger);
+        if (equal.n > 1 && pivot != LMS_END)
+            tasks->stack.push_back(equal);
+        tasks->busy--;
+        tasks->changed.notify_all();
+    }
+}
+
+/**
+ * @brief Parallel multikey quicksort.
+ */
+static void parallel_multikey_quicksort(LMS_key *keys, uint64_t n, unsigned threads)
+{
+    MKQS_tasks tasks;
+    MKQS_task all = {keys, n, 0};
+    tasks.stack.push_back(all);
+    tasks.busy = 0;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+        workers.push_back(std::thread(multikey_quicksort_worker, &tasks));
+    for (unsigned t = 0; t < threads; t++)
+        workers[t].join();
+}
+
+uint8_t **flbwt::sort_LMS_strings(uint8_t *T, flbwt::Container *container, unsigned threads,
+                                  flbwt::Workspace *workspace)
 {
     // array s will hold hashtable positions of sorted S* substrings
-    uint8_t **s = (uint8_t **)malloc((container->num_of_unique_substrings + 2) * sizeof(uint8_t *));
+    uint64_t s_bytes = (container->num_of_unique_substrings + 2) * sizeof(uint8_t *);
+    uint8_t **s = (uint8_t **)((workspace != NULL) ? workspace->acquire(s_bytes) : flbwt::mem_alloc(s_bytes));
 
     uint64_t p, i, j, l, m;
     uint8_t *r, *q;
@@ -391,7 +1209,7 @@ uint8_t **flbwt::sort_LMS_strings(uint8_t *T, flbwt::Container *container)
     uint64_t bufsize = container->hashtable->bufsize;
     uint64_t space_required = 1 + 1 + container->hashtable->calculate_lenlen(p + 1) + (p + 1) + container->hashtable->NAME_BYTES;
     space_required += 1 + 1 + 1 + 1 + container->hashtable->NAME_BYTES;
-    r = (uint8_t *)realloc(container->hashtable->buf, container->hashtable->bufsize + space_required);
+    r = (uint8_t *)flbwt::mem_realloc(container->hashtable->buf, container->hashtable->bufsize + space_required);
     if (r != container->hashtable->buf)
         container->hashtable->buf = r;
     container->hashtable->bufsize += space_required;
@@ -420,39 +1238,36 @@ uint8_t **flbwt::sort_LMS_strings(uint8_t *T, flbwt::Container *container)
 
     m = j - 1;
 
-    // sort the substrings by using quick sort
-    auto LMS_comparison = [T, container](uint8_t *p1, uint8_t *p2)
+    // sort the substrings by using multikey quicksort (length and characters are cached)
+    uint64_t keys_bytes = (m + 1) * sizeof(LMS_key);
+    LMS_key *keys = (LMS_key *)((workspace != NULL) ? workspace->acquire(keys_bytes) : flbwt::mem_alloc(keys_bytes));
+    for (i = 0; i < m; i++)
     {
-        uint64_t l1 = container->hashtable->get_length(p1);
-        uint64_t l2 = container->hashtable->get_length(p2);
-        int c1, c2;
-
-        p1 = container->hashtable->get_first_character_pointer(p1);
-        p2 = container->hashtable->get_first_character_pointer(p2);
+        keys[i].record = s[i + 1];
+        keys[i].chars = container->hashtable->get_first_character_pointer(s[i + 1]);
+        keys[i].length = container->hashtable->get_length(s[i + 1]);
+    }
 
-        // compare other characters
-        uint64_t n = 0;
-        while (l1 > 0 && l2 > 0)
-        {
-            // get next characters
-            c1 = *p1++;
-            c2 = *p2++;
-            n++;
+    if (threads > 1 && m > MKQS_PARALLEL_GRAIN)
+        parallel_multikey_quicksort(keys, m, threads);
+    else
+        multikey_quicksort(keys, m, 0);
 
-            if (c1 != c2)
-                break;
-            l1--;
-            l2--;
-        }
+    for (i = 0; i < m; i++)
+        s[i + 1] = keys[i].record;
 
-        if (l1 == 0)
-            return false;
-        if (l2 == 0)
-            return true;
-        return c1 < c2;
-    };
+    if (workspace != NULL)
+        workspace->release(keys); // e.g. T1 is built in it
+    else
+        flbwt::mem_free(keys);
 
-    std::sort(s + 1, s + 1 + m, LMS_comparison);
+    // remember which name each ordinal gets --> T1 can be built without hashing
+    if (container->occurrences != NULL)
+    {
+        container->ordinal_names = new flbwt::PackedArray(m, flbwt::position_of_msb(container->num_of_unique_substrings + 1));
+        for (i = 1; i <= m; i++)
+            container->ordinal_names->set_value(container->hashtable->get_name(s[i]), i);
+    }
 
     // assign the names for the substrings (fill them to hashtable)
     for (i = 1; i <= m; i++)
@@ -506,7 +1321,10 @@ uint8_t **flbwt::sort_LMS_strings(uint8_t *T, flbwt::Container *container)
     return s;
 }
 
-flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n, flbwt::Container *container)
+#define T1_BUFFER 1024 // names collected before they are packed into T1
+
+flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n, flbwt::Container *container,
+                                                   flbwt::Workspace *workspace)
 {
     // define how many substrings there is in total
     uint64_t total_substring_count = container->num_of_substrings + 2;
@@ -515,7 +1333,17 @@ flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n,
     uint64_t max_name = container->num_of_unique_substrings + 1;
     uint8_t bits = flbwt::position_of_msb(max_name);
     // number of bits required to store a name
-    PackedArray *T1 = new PackedArray(total_substring_count, bits);
+    PackedArray *T1;
+
+    if (workspace != NULL)
+    {
+        uint64_t words = flbwt::PackedArray::words_required(total_substring_count, bits);
+        T1 = new PackedArray(total_substring_count, bits, (uint64_t *)workspace->acquire(words * sizeof(uint64_t)));
+    }
+    else
+    {
+        T1 = new PackedArray(total_substring_count, bits);
+    }
 
     int previous_type = TYPE_L; // type of the previous character
     uint64_t p;                 // starting position of S* substring
@@ -525,6 +1353,47 @@ flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n,
     T1->set_value(j, 0);
     j--;
 
+    // T1 is filled from right to left, names are collected into buffer[b..]
+    // (buffer[0] is T1[j + 1]) and packed into T1 in one go when it is full
+    uint64_t buffer[T1_BUFFER];
+    uint64_t b = T1_BUFFER;
+
+    if (container->occurrences != NULL)
+    { // names are looked up with the ordinals recorded by extract_LMS_strings
+        uint64_t ordinals[T1_BUFFER];
+
+        for (uint64_t t = container->num_of_occurrence_queues; t-- > 0;)
+        {
+            flbwt::Queue *occurrences = container->occurrences[t];
+
+            while (!occurrences->is_empty())
+            {
+                uint64_t count = occurrences->dequeue(ordinals, T1_BUFFER);
+
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    buffer[--b] = container->ordinal_names->get_value(ordinals[i]);
+                    j--;
+
+                    if (b == 0)
+                    {
+                        T1->pack(j + 1, T1_BUFFER, buffer);
+                        b = T1_BUFFER;
+                    }
+                }
+            }
+
+            delete occurrences;
+            container->occurrences[t] = NULL;
+        }
+
+        T1->pack(j + 1, T1_BUFFER - b, buffer + b);
+        container->release_occurrences();
+
+        T1->set_value(0, max_name);
+        return T1;
+    }
+
     // scan the input string from right to left and save the S* substrings
     for (uint64_t i = n - 2; i >= 0; i--)
     {
@@ -545,9 +1414,15 @@ flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n,
                 uint64_t name = container->hashtable->find_name(q - p + 1, &T[p]);
 
                 // insert name to T1
-                T1->set_value(j, name);
+                buffer[--b] = name;
                 j--;
 
+                if (b == 0)
+                {
+                    T1->pack(j + 1, T1_BUFFER, buffer);
+                    b = T1_BUFFER;
+                }
+
                 q = p;
             }
 
@@ -558,6 +1433,7 @@ flbwt::PackedArray *flbwt::create_shortened_string(uint8_t *T, const uint64_t n,
             break; // to prevent integer underflow
     }
 
+    T1->pack(j + 1, T1_BUFFER - b, buffer + b);
     T1->set_value(0, max_name);
 
     return T1;
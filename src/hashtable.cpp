@@ -1,21 +1,47 @@
 #include <iostream>
 #include <algorithm>
+#include <new>
+#include <string.h>
 #include "hashtable.hpp"
+#include "memory.hpp"
 #include "utility.hpp"
 
-flbwt::HashTable::HashTable(const uint64_t hash_table_size, const uint64_t n)
+#define RECORD_BYTES_GUESS 16 // expected size of a record until the table is rehashed
+#define BLOCK_END_BYTES 13    // zeroed end of an element block (room for a pointer) and a spare byte
+
+flbwt::HashTable::HashTable(const uint64_t hash_table_size, const uint64_t n, const uint64_t shards,
+                            const flbwt::HashType hash_type)
 {
     this->HTSIZE = hash_table_size;
-    this->HBSIZE = 512;
-    this->rest = new uint64_t[this->HTSIZE];
-    this->head = new uint64_t[this->HTSIZE];
+    this->rest = flbwt::mem_new_array<uint64_t>(this->HTSIZE);
+    this->head = flbwt::mem_new_array<uint64_t>(this->HTSIZE);
     std::fill_n(this->rest, this->HTSIZE, 0);
     std::fill_n(this->head, this->HTSIZE, 0);
     this->buf = NULL;
     this->bufsize = 0;
     this->collisions = 0;
+    this->num_of_strings = 0;
+    this->next_ordinal = 0;
+    this->MAX_LOAD_FACTOR = 4;
+    this->HBSIZE = this->MAX_LOAD_FACTOR * RECORD_BYTES_GUESS + BLOCK_END_BYTES;
     this->LENGTH_X_BYTES = 1;
     this->SENTINEL_CHAR_BYTES = 1;
+    this->HASH_TYPE = hash_type;
+    this->SHARDS = shards;
+    this->shards = NULL;
+    this->shared_size = this->HTSIZE;
+
+    if (this->SHARDS > 1)
+    {
+        this->shards = new HashShard[this->SHARDS];
+        for (uint64_t i = 0; i < this->SHARDS; i++)
+        {
+            this->shards[i].buf = NULL;
+            this->shards[i].bufsize = 0;
+            this->shards[i].collisions = 0;
+            this->shards[i].strings = 0;
+        }
+    }
 
     // there can be maximum of n/2 substrings (names)
     uint64_t max_name = n / 2 + 1;
@@ -23,47 +49,108 @@ flbwt::HashTable::HashTable(const uint64_t hash_table_size, const uint64_t n)
     this->NAME_BYTES = bits / 8;
     if (bits % 8 != 0)
         this->NAME_BYTES++;
+
+    // head and rest take 16 bytes per bucket --> the table grows to about n bytes at most
+    this->MAX_HTSIZE = std::max(hash_table_size, n / 16) | 1;
 }
 
 uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p)
+{
+    uint64_t ordinal;
+    return this->insert_string(m, p, ordinal);
+}
+
+uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p, uint64_t &ordinal)
+{
+    if (this->shards == NULL)
+    {
+        // start by calculating the hash
+        uint64_t h = this->hash_function(m, p);
+
+        if (this->insert_string(h, m, p, this->buf, this->bufsize, this->collisions, ordinal) == 0)
+            return 0;
+
+        // keep the chains short --> grow the table when it gets too full
+        if (++this->num_of_strings > this->MAX_LOAD_FACTOR * this->HTSIZE && this->MAX_LOAD_FACTOR != 0 &&
+            this->HTSIZE < this->MAX_HTSIZE)
+            this->rehash(std::min(2 * this->HTSIZE + 1, this->MAX_HTSIZE));
+
+        return 1;
+    }
+
+    // bucket h is only ever touched by the shard that owns it. The table may grow between
+    // hashing and locking the shard --> the size is checked again under the lock.
+    for (;;)
+    {
+        uint64_t size = this->shared_size;
+        uint64_t h = this->hash_function(m, p, size);
+        flbwt::HashShard &shard = this->shards[h % this->SHARDS];
+        std::unique_lock<std::mutex> guard(shard.lock);
+
+        if (this->HTSIZE != size)
+            continue;
+
+        if (this->insert_string(h, m, p, shard.buf, shard.bufsize, shard.collisions, ordinal) == 0)
+            return 0;
+
+        // the shard holds about 1 / SHARDS of the buckets --> grow when it gets too full
+        if (++shard.strings > this->MAX_LOAD_FACTOR * this->HTSIZE / this->SHARDS && this->MAX_LOAD_FACTOR != 0 &&
+            this->HTSIZE < this->MAX_HTSIZE)
+        {
+            guard.unlock();
+            this->grow_shards(size);
+        }
+
+        return 1;
+    }
+}
+
+void flbwt::HashTable::grow_shards(const uint64_t size)
+{
+    // shards are always locked in the same order --> no deadlock with other growing threads
+    for (uint64_t i = 0; i < this->SHARDS; i++)
+        this->shards[i].lock.lock();
+
+    if (this->HTSIZE == size)
+    {
+        this->rehash(std::min(2 * this->HTSIZE + 1, this->MAX_HTSIZE));
+        this->shared_size = this->HTSIZE;
+    }
+
+    for (uint64_t i = 0; i < this->SHARDS; i++)
+        this->shards[i].lock.unlock();
+}
+
+uint8_t flbwt::HashTable::insert_string(const uint64_t h, const uint64_t m, uint8_t *p,
+                                        uint8_t *&buf, uint64_t &bufsize, uint64_t &collisions, uint64_t &ordinal)
 {
     uint64_t i;  // index of the substring
-    uint64_t pp; // previous substring starting index
     uint64_t l;  // length of substring under comparison
     uint8_t *r = NULL;
-    uint8_t *r2 = NULL;
     uint8_t l2;
-    uint64_t q2;
-
-    // start by calculating the hash
-    uint64_t h = this->hash_function(m, p);
 
     // If a string with same hash exists, keep scanning until
     // free position is reached, or duplicate is detected.
     uint64_t q = this->head[h];
     while (q != 0)
     {
-        pp = q;
-        r = &this->buf[q];
+        r = &buf[q];
         l = this->get_length(r);
 
         if (l == 0)
-        {
-            r = &this->buf[pp];
             break; // no more strings found
-        }
 
         if (l == 2) // end of block --> continue from next point
         {
             q = this->get_pointer(r);
-            this->collisions++;
+            collisions++;
             continue;
         }
 
         if (l != m) // not the same string if length differs
         {
             q += this->string_info_length(r, l);
-            this->collisions++;
+            collisions++;
             continue;
         }
 
@@ -71,29 +158,45 @@ uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p)
         l2 = this->get_lenlen(r);
         for (i = 0U; i < m; i++)
         {
-            if (p[i] != this->buf[q + this->SENTINEL_CHAR_BYTES + this->LENGTH_X_BYTES + l2 + i])
+            if (p[i] != buf[q + this->SENTINEL_CHAR_BYTES + this->LENGTH_X_BYTES + l2 + i])
                 break;
         }
 
         if (i == m) // duplicate string
+        {
+            ordinal = this->get_name(r);
             return 0;
+        }
 
         q += this->string_info_length(r, l);
-        this->collisions++;
+        collisions++;
     }
 
+    ordinal = this->next_ordinal++;
+    this->append_string(h, q, m, p, ordinal, buf, bufsize);
+
+    return 1; // new string added
+}
+
+uint8_t *flbwt::HashTable::append_string(const uint64_t h, uint64_t q, const uint64_t m, uint8_t *p,
+                                         const uint64_t ordinal, uint8_t *&buf, uint64_t &bufsize)
+{
+    uint8_t *r = &buf[q];
+    uint8_t *r2 = NULL;
+    uint64_t q2;
+
     // resize the bit-vector if needed
     uint8_t length_bytes = this->calculate_lenlen(m);
     uint64_t space_required = this->SENTINEL_CHAR_BYTES + this->LENGTH_X_BYTES + length_bytes + m + this->NAME_BYTES;
     if ((int64_t)space_required >= (int64_t)this->rest[h] - 12)
     {
-        r2 = (uint8_t *)realloc(this->buf, this->bufsize + this->HBSIZE + space_required);
+        r2 = (uint8_t *)flbwt::mem_realloc(buf, bufsize + this->HBSIZE + space_required);
 
-        if (r2 != this->buf)
-            this->buf = r2;
+        if (r2 != buf)
+            buf = r2;
 
-        q2 = this->bufsize + 1;
-        this->bufsize += this->HBSIZE + space_required;
+        q2 = bufsize + 1;
+        bufsize += this->HBSIZE + space_required;
         this->rest[h] = this->HBSIZE + space_required;
 
         if (q == 0)
@@ -103,13 +206,14 @@ uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p)
         }
         else
         {
-            r2 = &this->buf[pp];
+            r2 = &buf[q];
             this->set_pointer(r2, q2);
         }
 
-        r = &this->buf[q2];
+        r = &buf[q2];
     }
 
+    uint8_t *record = r;
     this->set_length(r, m);
     r += 1 + length_bytes;
     *r++ = p[0] + 1; // sentinel
@@ -118,8 +222,14 @@ uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p)
         *r++ = p[i];
     }
 
-    // jump over name bytes
+    // store ordinal to name bytes
+    uint64_t name = ordinal;
     r += this->NAME_BYTES;
+    for (uint8_t i = 1; i <= this->NAME_BYTES; i++)
+    {
+        r[-i] = name & 0xff;
+        name >>= 8;
+    }
 
     // reset the following fields
     for (uint8_t i = 0; i < 12; i++)
@@ -127,11 +237,19 @@ uint8_t flbwt::HashTable::insert_string(const uint64_t m, uint8_t *p)
 
     this->rest[h] -= space_required;
 
-    return 1; // new string added
+    return record;
 }
 
 uint64_t flbwt::HashTable::hash_function(const uint64_t m, uint8_t *p)
 {
+    return this->hash_function(m, p, this->HTSIZE);
+}
+
+uint64_t flbwt::HashTable::hash_function(const uint64_t m, uint8_t *p, const uint64_t size)
+{
+    if (this->HASH_TYPE == flbwt::HASH_WORD)
+        return this->word_hash_function(m, p, size);
+
     uint64_t x = 0;
 
     for (uint64_t i = 0; i < m; i++)
@@ -141,11 +259,49 @@ uint64_t flbwt::HashTable::hash_function(const uint64_t m, uint8_t *p)
         x += *p++;
     }
 
-    x %= this->HTSIZE;
+    x %= size;
 
     return x;
 }
 
+uint64_t flbwt::HashTable::word_hash_function(const uint64_t m, uint8_t *p)
+{
+    return this->word_hash_function(m, p, this->HTSIZE);
+}
+
+uint64_t flbwt::HashTable::word_hash_function(const uint64_t m, uint8_t *p, const uint64_t size)
+{
+    const uint64_t K = 0x9e3779b97f4a7c15; // odd multiplier (golden ratio)
+    uint64_t x = m * K;
+    uint64_t w;
+    uint64_t i = 0;
+
+    for (; i + 8 <= m; i += 8)
+    {
+        memcpy(&w, p + i, 8); // unaligned load
+        x = (x ^ w) * K;
+        x ^= x >> 29;
+    }
+
+    if (i < m)
+    { // remaining 1..7 bytes
+        w = 0;
+        memcpy(&w, p + i, m - i);
+        x = (x ^ w) * K;
+        x ^= x >> 29;
+    }
+
+    // finalize (murmur3 fmix64) so that all bits affect the upper bits
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+
+    // fastrange: map x to [0, size) without division
+    return (uint64_t)(((unsigned __int128)x * size) >> 64);
+}
+
 uint64_t flbwt::HashTable::get_length(uint8_t *p)
 {
     uint8_t bytes = *p++; // number of bytes used to store the length
@@ -175,7 +331,8 @@ void flbwt::HashTable::set_length(uint8_t *p, uint64_t length)
         (*r)--;
     }
 
-    while (length != 0)
+    // write all length bytes (also the trailing zero bytes)
+    for (uint8_t i = 0; i < *r; i++)
     {
         value = (length & 0xff00000000000000) >> 56;
         *p++ = value;
@@ -341,13 +498,244 @@ uint64_t flbwt::HashTable::find_name(uint64_t m, uint8_t *p)
     throw std::runtime_error("hashtable->find_name() failed: Substring was not found");
 }
 
+void flbwt::HashTable::merge_shards()
+{
+    if (this->shards == NULL)
+        return;
+
+    // base position of each shard arena in the merged buf
+    uint64_t *base = flbwt::mem_new_array<uint64_t>(this->SHARDS);
+    uint64_t total = this->bufsize;
+
+    for (uint64_t i = 0; i < this->SHARDS; i++)
+    {
+        base[i] = total;
+        total += this->shards[i].bufsize;
+    }
+
+    uint8_t *r = (uint8_t *)flbwt::mem_realloc(this->buf, total);
+    if (r != this->buf)
+        this->buf = r;
+    this->bufsize = total;
+
+    for (uint64_t i = 0; i < this->SHARDS; i++)
+    {
+        if (this->shards[i].buf != NULL)
+        {
+            std::copy(this->shards[i].buf, this->shards[i].buf + this->shards[i].bufsize, this->buf + base[i]);
+            flbwt::mem_free(this->shards[i].buf);
+        }
+        this->collisions += this->shards[i].collisions;
+        this->num_of_strings += this->shards[i].strings;
+    }
+
+    // relocate the bucket heads and the pointers between the element blocks
+    uint64_t q;
+    uint64_t l;
+    for (uint64_t h = 0; h < this->HTSIZE; h++)
+    {
+        if (this->head[h] == 0)
+            continue;
+
+        this->head[h] += base[h % this->SHARDS];
+        q = this->head[h];
+
+        while (q != 0)
+        {
+            r = &this->buf[q];
+            l = this->get_length(r);
+
+            if (l == 0) // last string for hashtable index
+                break;
+
+            if (l == 2) // end of block --> relocate and continue from next point
+            {
+                q = this->get_pointer(r) + base[h % this->SHARDS];
+                this->set_pointer(r, q);
+                continue;
+            }
+
+            q += this->string_info_length(r, l);
+        }
+    }
+
+    flbwt::mem_free(base);
+    delete[] this->shards;
+    this->shards = NULL;
+    this->SHARDS = 1;
+
+    // each shard grows the table by its own count --> catch up if the shards filled it unevenly
+    if (this->MAX_LOAD_FACTOR != 0 && this->num_of_strings > this->MAX_LOAD_FACTOR * this->HTSIZE &&
+        this->HTSIZE < this->MAX_HTSIZE)
+        this->rehash(std::min(2 * this->num_of_strings / this->MAX_LOAD_FACTOR + 1, this->MAX_HTSIZE));
+}
+
+void flbwt::HashTable::rehash(const uint64_t hash_table_size)
+{
+    uint64_t *old_head = this->head;
+    uint64_t old_size = this->HTSIZE;
+    uint64_t arenas = (this->shards != NULL) ? this->SHARDS : 1;
+
+    // bucket h is in arena h % arenas (a shard, or buf when the table is not sharded)
+    uint8_t **old_buf = flbwt::mem_new_array<uint8_t *>(arenas);
+    uint64_t strings = this->num_of_strings;
+
+    if (this->shards == NULL)
+        old_buf[0] = this->buf;
+    for (uint64_t i = 0; this->shards != NULL && i < arenas; i++)
+    {
+        old_buf[i] = this->shards[i].buf;
+        strings += this->shards[i].strings;
+    }
+
+    this->HTSIZE = hash_table_size;
+    this->head = flbwt::mem_new_array<uint64_t>(this->HTSIZE);
+    std::fill_n(this->head, this->HTSIZE, 0);
+    flbwt::mem_free(this->rest);
+    this->rest = flbwt::mem_new_array<uint64_t>(this->HTSIZE);
+    std::fill_n(this->rest, this->HTSIZE, 0);
+
+    uint64_t q;
+    uint64_t l;
+    uint64_t h;
+    uint8_t *r;
+
+    // 1st pass: bytes of the records of each new bucket (in rest)
+    uint64_t record_bytes = 0;
+
+    for (uint64_t i = 0; i < old_size; i++)
+    {
+        q = old_head[i];
+        while (q != 0)
+        {
+            r = &old_buf[i % arenas][q];
+            l = this->get_length(r);
+
+            if (l == 0) // last string for hashtable index
+                break;
+
+            if (l == 2) // end of block --> continue from next point
+            {
+                q = this->get_pointer(r);
+                continue;
+            }
+
+            h = this->hash_function(l, this->get_first_character_pointer(r));
+            this->rest[h] += this->string_info_length(r, l);
+            record_bytes += this->string_info_length(r, l);
+
+            q += this->string_info_length(r, l);
+        }
+    }
+
+    // a bucket gets about MAX_LOAD_FACTOR - load more substrings before the next rehash
+    // --> that many average records are left free in each block
+    uint64_t load = strings / this->HTSIZE;
+    uint64_t growth = (this->MAX_LOAD_FACTOR > load) ? this->MAX_LOAD_FACTOR - load : 1;
+    uint64_t average = (strings != 0) ? (record_bytes + strings - 1) / strings : RECORD_BYTES_GUESS;
+    this->HBSIZE = growth * average + BLOCK_END_BYTES;
+
+    // every non-empty bucket is a single block: its records and HBSIZE free bytes
+    uint64_t *total = flbwt::mem_new_array<uint64_t>(arenas);
+    std::fill_n(total, arenas, 1); // position 0 means an empty bucket
+    uint64_t *tail = flbwt::mem_new_array<uint64_t>(this->HTSIZE); // end position of each new bucket
+
+    for (h = 0; h < this->HTSIZE; h++)
+    {
+        tail[h] = 0;
+        if (this->rest[h] == 0)
+            continue;
+
+        this->head[h] = tail[h] = total[h % arenas];
+        total[h % arenas] += this->rest[h] + this->HBSIZE;
+        this->rest[h] += this->HBSIZE;
+    }
+
+    for (uint64_t i = 0; i < arenas; i++)
+    {
+        uint8_t *arena = (uint8_t *)flbwt::mem_alloc(total[i]);
+        if (arena == NULL)
+            throw std::bad_alloc();
+
+        if (this->shards == NULL)
+        {
+            this->buf = arena;
+            this->bufsize = total[i];
+        }
+        else
+        {
+            this->shards[i].buf = arena;
+            this->shards[i].bufsize = total[i];
+        }
+    }
+
+    // 2nd pass: substrings are unique --> append them to the new buckets without comparing
+    uint8_t *record;
+
+    for (uint64_t i = 0; i < old_size; i++)
+    {
+        q = old_head[i];
+        while (q != 0)
+        {
+            r = &old_buf[i % arenas][q];
+            l = this->get_length(r);
+
+            if (l == 0) // last string for hashtable index
+                break;
+
+            if (l == 2) // end of block --> continue from next point
+            {
+                q = this->get_pointer(r);
+                continue;
+            }
+
+            uint8_t *p = this->get_first_character_pointer(r);
+            h = this->hash_function(l, p);
+            uint8_t *&buf = (this->shards != NULL) ? this->shards[h % arenas].buf : this->buf;
+            uint64_t &bufsize = (this->shards != NULL) ? this->shards[h % arenas].bufsize : this->bufsize;
+            record = this->append_string(h, tail[h], l, p, this->get_name(r), buf, bufsize);
+            tail[h] = record - buf + this->string_info_length(record, l);
+
+            q += this->string_info_length(r, l);
+        }
+    }
+
+    for (uint64_t i = 0; i < arenas; i++)
+        flbwt::mem_free(old_buf[i]);
+    flbwt::mem_free(total);
+    flbwt::mem_free(tail);
+    flbwt::mem_free(old_head);
+    flbwt::mem_free(old_buf);
+}
+
+uint64_t flbwt::HashTable::recommended_size(const uint64_t n)
+{
+    // 16 bytes per bucket --> stay within a few percent of the input size
+    uint64_t size = n / 256;
+
+    if (size < 67777)
+        size = 67777;
+
+    return size | 1;
+}
+
 flbwt::HashTable::~HashTable()
 {
-    delete[] this->rest;
+    flbwt::mem_free(this->rest);
     this->rest = NULL;
-    delete[] this->head;
+    flbwt::mem_free(this->head);
     this->head = NULL;
-    if (this->buf != NULL)
-        free(this->buf);
+    flbwt::mem_free(this->buf);
     this->buf = NULL;
+
+    if (this->shards != NULL)
+    {
+        for (uint64_t i = 0; i < this->SHARDS; i++)
+        {
+            if (this->shards[i].buf != NULL)
+                flbwt::mem_free(this->shards[i].buf);
+        }
+        delete[] this->shards;
+        this->shards = NULL;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "induce.hpp"
+#include "memory.hpp"
+#include "queue.hpp"
+#include "sais.hpp"
+#include "thread_pool.hpp"
+
+#ifndef TYPE_S
+#define TYPE_S 0
+#define TYPE_L 1
+#define TYPE_LMS 2
+#endif
+
+#define INDUCE_PARALLEL_BATCH 65536 // queue entries dequeued at once when the preceding characters are read in parallel
+#define INDUCE_PARALLEL_MIN 4096    // smaller batches are read by the calling thread
+
+/**
+ * @brief Read the characters preceding the queued suffixes batch[from..to) of bucket c (first pass).
+ * prev2 is read only for the suffixes that are preceded by a TYPE_L character.
+ */
+static void gather_L(const uint64_t *batch, uint64_t from, uint64_t to, const uint8_t *bwp_base,
+                     const uint8_t *lastptr, int64_t c, uint8_t *prev1, uint8_t *prev2)
+{
+    for (uint64_t j = from; j < to; j++)
+    {
+        const uint8_t *q = bwp_base + batch[j];
+
+        if (q == lastptr)
+            continue;
+
+        prev1[j] = q[-1];
+
+        if (prev1[j] >= c - 1)
+            prev2[j] = q[-2];
+    }
+}
+
+/**
+ * @brief Read the characters preceding the queued suffixes batch[from..to) of bucket c (second pass).
+ */
+static void gather_S(const uint64_t *batch, uint64_t from, uint64_t to, const uint8_t *bwp_base,
+                     const uint8_t *lastptr, int64_t c, uint8_t *prev1, uint8_t *prev2)
+{
+    for (uint64_t j = from; j < to; j++)
+    {
+        const uint8_t *q = bwp_base + batch[j];
+        prev1[j] = q[-1];
+
+        if (prev1[j] <= c - 1 && q - 1 != lastptr)
+            prev2[j] = q[-2];
+    }
+}
+
+/**
+ * @brief Run gather for a batch of k entries, in parallel if the batch is large enough.
+ */
+static void gather(flbwt::ThreadPool &threads, uint64_t k,
+                   void (*function)(const uint64_t *, uint64_t, uint64_t, const uint8_t *, const uint8_t *,
+                                    int64_t, uint8_t *, uint8_t *),
+                   const uint64_t *batch, const uint8_t *bwp_base, const uint8_t *lastptr, int64_t c,
+                   uint8_t *prev1, uint8_t *prev2)
+{
+    if (threads.size() == 1 || k < INDUCE_PARALLEL_MIN)
+    {
+        function(batch, 0, k, bwp_base, lastptr, c, prev1, prev2);
+        return;
+    }
+
+    threads.parallel_for(k, [&](uint64_t from, uint64_t to) {
+        function(batch, from, to, bwp_base, lastptr, c, prev1, prev2);
+    });
+}
+
+template <class Storage>
+flbwt::BWT_result *flbwt::induce_bwt(Storage SA, flbwt::Container *container, uint8_t *BWT, unsigned threads,
+                                     flbwt::Stats *stats, flbwt::QueuePool *pool, flbwt::Workspace *workspace)
+{
+    uint8_t bwp_w = container->bwp_width;
+    uint8_t *bwp_base = container->bwp_base;
+
+    // define variable to hold all queues, blocks are shared through a single pool
+    flbwt::QueuePool *private_pool = NULL;
+
+    if (pool == NULL)
+        pool = private_pool = new flbwt::QueuePool(bwp_w);
+    else if (pool->get_width() != bwp_w)
+        throw std::invalid_argument("induce_bwt failed(): Width of the queue pool does not match the container");
+
+    flbwt::Queue *Q[3][256 + 2];
+
+    // initialize queues
+    for (uint16_t i = 0; i <= 256 + 1; i++)
+    {
+        Q[TYPE_LMS][i] = new flbwt::Queue(pool);
+        Q[TYPE_L][i] = new flbwt::Queue(pool);
+        Q[TYPE_S][i] = new flbwt::Queue(pool);
+    }
+
+    // queue entries are processed in batches: the characters preceding them are read
+    // first (in parallel), then BWT and the queues are updated in queue order
+    flbwt::ThreadPool workers(threads);
+    uint64_t batch_size = (threads > 1) ? INDUCE_PARALLEL_BATCH : QBATCH;
+    std::vector<uint64_t> batch(batch_size);
+    std::vector<uint8_t> prev1(batch_size);
+    std::vector<uint8_t> prev2(batch_size);
+    uint8_t *lastptr = container->lastptr;
+    uint64_t k;
+    uint64_t j;
+
+    int64_t i;
+    int64_t c;
+    uint8_t *q;
+
+    for (i = container->num_of_substrings; i >= 0; i--)
+    {
+        q = SA.get(i) + bwp_base;
+
+        if (i == 0)
+        {
+            c = -1;
+        }
+        else
+        {
+            c = q[0];
+        }
+
+        Q[TYPE_LMS][c + 1]->enqueue_l(q - bwp_base);
+    }
+
+    // release SA --> big performance boost (its memory is reused for the BWT)
+    if (workspace != NULL)
+        workspace->release(SA.get_arena());
+    else
+        SA.release();
+
+    // a buffer of the caller gets the n characters only --> the slot of the first suffix
+    // (last, the sentinel) is skipped instead of being cut out afterwards
+    bool skip_last = (BWT != NULL);
+
+    // allocate memory for bwt (unless caller provided the buffer), the workspace hands the
+    // SA arena over if it is large enough
+    if (BWT == NULL && workspace != NULL)
+    {
+        BWT = workspace->detach(workspace->acquire(container->n + 1), container->n + 1);
+    }
+    else if (BWT == NULL)
+    {
+        BWT = new uint8_t[container->n + 1];
+        flbwt::mem_track(container->n + 1);
+    }
+
+    int64_t cc = 0;
+    for (i = 0; i <= 256 + 1; i++)
+    {
+        container->M3[i] = container->M2[i] = cc;
+        cc += container->M[i];
+    }
+
+    // C2 is the beginning of TYPE_S bucket
+    for (i = 0; i <= 256 + 1; i++)
+        container->C2[i] = container->M2[i] + container->NL[i];
+
+    // The first suffix (rank last) is in the bucket of T[0]. Skipping its slot moves every
+    // later part of BWT one position down, M3 keeps the ranks.
+    int64_t first_bucket = lastptr[0] + 1;
+
+    if (skip_last)
+    {
+        // type of T[0] --> the slot is in the TYPE_L or in the TYPE_S part of the bucket
+        uint64_t h = 0;
+        uint64_t end = std::min(container->head_string_end, container->n - 1);
+
+        while (h < end && lastptr[h] == lastptr[h + 1])
+            h++;
+
+        bool first_is_S = (h < end && lastptr[h] < lastptr[h + 1]);
+
+        for (i = first_bucket + 1; i <= 256 + 1; i++)
+        {
+            container->M2[i]--;
+            container->C2[i]--;
+        }
+
+        if (!first_is_S)
+            container->C2[first_bucket]--;
+    }
+
+    // M2: Copy destination address, default is the beginning of the bucket
+    // C2: The address of the stack that temporarily stores bwt, the initial value is the position of the S bucket.
+    // M3: Bucket position (doesn't change)
+
+    int64_t c1;
+    int64_t c2;
+    i = 0;
+    q = bwp_base + Q[TYPE_LMS][i]->dequeue();
+    c1 = q[-1];
+    c2 = -1;
+    BWT[0] = c1;
+    Q[TYPE_L][c1 + 1]->enqueue((q - 1) - bwp_base);
+    if (!skip_last || q - 1 != lastptr)
+        BWT[container->M2[c1 + 1]++] = q[-2];
+    BWT[container->C2[c2 + 1]++] = c1;
+
+    int64_t m;
+    int t;
+    uint64_t last;
+
+    for (c = 1; c <= 256 + 1; c++)
+    {
+        for (t = 1; t <= 2; t++)
+        {                         // process TYPE_L and TYPE LMS in sequence
+            m = container->M3[c]; // head of L bucket
+
+            if (t == TYPE_LMS)
+                m += container->M[c] - container->C[c]; // head of LMS bucket
+
+            while (!Q[t][c]->is_empty())
+            {
+                k = Q[t][c]->dequeue(batch.data(), batch_size);
+                gather(workers, k, gather_L, batch.data(), bwp_base, lastptr, c, prev1.data(), prev2.data());
+
+                for (j = 0; j < k; j++)
+                {
+                    if (bwp_base + batch[j] == lastptr)
+                    {
+                        last = m;
+                    }
+                    else
+                    {
+                        c1 = prev1[j];
+
+                        if (c1 >= c - 1)
+                        { // TYPE_L
+                            Q[TYPE_L][c1 + 1]->enqueue(batch[j] - 1);
+                            if (!skip_last || bwp_base + batch[j] - 1 != lastptr)
+                                BWT[container->M2[c1 + 1]++] = prev2[j];
+
+                            if (t == TYPE_LMS)
+                            {
+                                BWT[container->C2[c]++] = c1;
+                            }
+                        }
+                        else
+                        {
+                            Q[TYPE_S][c]->enqueue_l(batch[j]);
+                        }
+                    }
+
+                    m++;
+                }
+            }
+        }
+    }
+
+    // all TYPE_L queues are drained by now (an LMS suffix is never preceded by
+    // an equal character), so they are reused for the second pass
+    for (c = 0; c <= 256 + 1; c++)
+        delete Q[TYPE_LMS][c];
+
+    container->M2[0] = 0;
+    for (c = 1; c <= 256 + 1; c++)
+        container->M2[c] = container->M2[c - 1] + container->M[c];
+
+    // the TYPE_S parts from the first bucket on end one position lower. The stack of the
+    // first bucket stays, it holds S* suffixes only and never reaches the skipped slot.
+    if (skip_last)
+    {
+        for (c = first_bucket; c <= 256 + 1; c++)
+            container->M2[c]--;
+    }
+
+    int64_t c0;
+    for (c = 256 + 1; c >= 0; c--)
+    {
+        for (t = 1; t >= 0; t--)
+        {
+            while(!Q[t][c]->is_empty())
+            {
+                k = Q[t][c]->dequeue(batch.data(), batch_size);
+                gather(workers, k, gather_S, batch.data(), bwp_base, lastptr, c, prev1.data(), prev2.data());
+
+                for (j = 0; j < k; j++)
+                {
+                    c1 = prev1[j];
+
+                    if (c1 <= c - 1)
+                    {
+                        Q[TYPE_L][c1 + 1]->enqueue(batch[j] - 1);
+
+                        if (bwp_base + batch[j] - 1 == lastptr)
+                        { // a skipped slot is not taken, the cursor is already one below it
+                            last = skip_last ? container->M2[c1 + 1] + 1 : container->M2[c1 + 1]--;
+                        }
+                        else
+                        {
+                            c0 = prev2[j];
+                            BWT[container->M2[c1 + 1]--] = (c0 <= c1) ? c0 : BWT[--container->C2[c1 + 1]];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i <= 256 + 1; i++)
+    {
+        delete Q[TYPE_L][i];
+        delete Q[TYPE_S][i];
+    }
+
+    if (stats != NULL)
+    {
+        stats->queue_blocks += pool->get_num_of_blocks();
+        stats->spilled_blocks += pool->get_num_of_spilled_blocks();
+    }
+
+    delete private_pool;
+
+    // return the result bwt
+    BWT_result *bwt_result = (BWT_result *)malloc(sizeof(BWT_result));
+    bwt_result->last = last;
+    bwt_result->BWT = BWT;
+
+    return bwt_result;
+}
+
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStorage32>(flbwt::SAStorage32, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStorage40>(flbwt::SAStorage40, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStorage48>(flbwt::SAStorage48, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStorage56>(flbwt::SAStorage56, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStorage64>(flbwt::SAStorage64, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStoragePacked40>(flbwt::SAStoragePacked40, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStoragePacked48>(flbwt::SAStoragePacked48, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
+template flbwt::BWT_result *flbwt::induce_bwt<flbwt::SAStoragePacked56>(flbwt::SAStoragePacked56, flbwt::Container *, uint8_t *, unsigned, flbwt::Stats *, flbwt::QueuePool *, flbwt::Workspace *);
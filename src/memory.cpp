@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <malloc.h>
+#include <atomic>
+#include "memory.hpp"
+
+// signed, so that memory freed here but allocated elsewhere can not wrap the counter
+static std::atomic<int64_t> current_bytes(0);
+static std::atomic<int64_t> peak_bytes(0);
+
+void flbwt::mem_track(uint64_t bytes)
+{
+    int64_t now = current_bytes.fetch_add(bytes) + bytes;
+    int64_t peak = peak_bytes.load();
+
+    while (now > peak && !peak_bytes.compare_exchange_weak(peak, now))
+        ;
+}
+
+void flbwt::mem_untrack(uint64_t bytes)
+{
+    current_bytes.fetch_sub(bytes);
+}
+
+void *flbwt::mem_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+
+    if (ptr != NULL)
+        flbwt::mem_track(malloc_usable_size(ptr));
+
+    return ptr;
+}
+
+void *flbwt::mem_realloc(void *ptr, size_t size)
+{
+    uint64_t old_size = (ptr == NULL) ? 0 : malloc_usable_size(ptr);
+    void *r = realloc(ptr, size);
+
+    if (r != NULL)
+    {
+        flbwt::mem_untrack(old_size);
+        flbwt::mem_track(malloc_usable_size(r));
+    }
+
+    return r;
+}
+
+void flbwt::mem_free(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    flbwt::mem_untrack(malloc_usable_size(ptr));
+    free(ptr);
+}
+
+int64_t flbwt::mem_current()
+{
+    return current_bytes.load();
+}
+
+int64_t flbwt::mem_peak()
+{
+    return peak_bytes.load();
+}
+
+void flbwt::mem_reset_peak()
+{
+    peak_bytes.store(current_bytes.load());
+}
@@ -1,5 +1,6 @@
 #include <cstdlib>
 #include <stddef.h>
+#include "memory.hpp"
 #include "packed_array.hpp"
 #include "utility.hpp"
 
@@ -9,10 +10,19 @@ flbwt::PackedArray::PackedArray(uint64_t length, uint8_t integer_bits)
     this->integer_bits = integer_bits;
 
     // Allocate space for integers (excluding sign bits)
-    uint64_t bits_required = length * this->integer_bits;
-    uint64_t arr_length = bits_required / 64 + 1;
-    this->arr = (uint64_t *)malloc(arr_length * sizeof(uint64_t));
+    uint64_t arr_length = flbwt::PackedArray::words_required(length, integer_bits);
+    this->arr = (uint64_t *)flbwt::mem_alloc(arr_length * sizeof(uint64_t));
     this->arr_length = arr_length;
+    this->owns_arr = true;
+}
+
+flbwt::PackedArray::PackedArray(uint64_t length, uint8_t integer_bits, uint64_t *arr)
+{
+    this->length = length;
+    this->integer_bits = integer_bits;
+    this->arr = arr;
+    this->arr_length = flbwt::PackedArray::words_required(length, integer_bits);
+    this->owns_arr = false;
 }
 
 uint64_t flbwt::PackedArray::get_length()
@@ -27,59 +37,187 @@ uint8_t flbwt::PackedArray::get_integer_bits()
 
 void flbwt::PackedArray::set_value(uint64_t index, uint64_t value)
 {
+    flbwt::PackedArray::set_value(this->arr, this->integer_bits, index, value);
+}
+
+uint64_t flbwt::PackedArray::get_value(uint64_t index)
+{
+    return flbwt::PackedArray::get_value(this->arr, this->integer_bits, index);
+}
+
+uint64_t flbwt::PackedArray::words_required(uint64_t length, uint8_t integer_bits)
+{
+    return length * integer_bits / 64 + 1;
+}
+
+void flbwt::PackedArray::set_value(uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t value)
+{
+    switch (integer_bits)
+    {
+    case 8:
+        flbwt::FixedPackedArray<8>::set_value(arr, index, value);
+        return;
+    case 16:
+        flbwt::FixedPackedArray<16>::set_value(arr, index, value);
+        return;
+    case 32:
+        flbwt::FixedPackedArray<32>::set_value(arr, index, value);
+        return;
+    }
+
     // Calculate index in value array
-    uint64_t arr_index = this->integer_bits * index / 64;
-    uint64_t bit_index = 63 - ((this->integer_bits * index) % 64);
+    uint64_t arr_index = integer_bits * index / 64;
+    uint64_t bit_index = 63 - ((integer_bits * index) % 64);
 
     uint64_t bitmask1 = BIT_MASK(uint64_t, bit_index + 1);
     uint64_t bitmask2;
     int8_t shift;
 
-    if (bit_index + 1 >= this->integer_bits)
+    if (bit_index + 1 >= integer_bits)
     { // Enough space --> no need to split
-        bitmask2 = BIT_MASK(uint64_t, bit_index + 1 - this->integer_bits);
+        bitmask2 = BIT_MASK(uint64_t, bit_index + 1 - integer_bits);
         bitmask1 = bitmask1 & (~bitmask2);
-        shift = bit_index + 1 - this->integer_bits;
-        this->arr[arr_index] = (this->arr[arr_index] & (~bitmask1)) | (value << shift);
+        shift = bit_index + 1 - integer_bits;
+        arr[arr_index] = (arr[arr_index] & (~bitmask1)) | (value << shift);
     }
     else
     { // Not enough space --> splitting needed
         uint8_t wfp = bit_index + 1;
-        uint8_t wsp = this->integer_bits - wfp;
-        this->arr[arr_index] = (this->arr[arr_index] & (~bitmask1)) | (value >> wsp);
+        uint8_t wsp = integer_bits - wfp;
+        arr[arr_index] = (arr[arr_index] & (~bitmask1)) | (value >> wsp);
         bitmask2 = 0xffffffffffffffff << (64 - wsp);
-        this->arr[arr_index + 1] = (this->arr[arr_index + 1] & (~bitmask2)) | (value << (64 - wsp));
+        arr[arr_index + 1] = (arr[arr_index + 1] & (~bitmask2)) | (value << (64 - wsp));
     }
 }
 
-uint64_t flbwt::PackedArray::get_value(uint64_t index)
+uint64_t flbwt::PackedArray::get_value(const uint64_t *arr, uint8_t integer_bits, uint64_t index)
 {
+    switch (integer_bits)
+    {
+    case 8:
+        return flbwt::FixedPackedArray<8>::get_value(arr, index);
+    case 16:
+        return flbwt::FixedPackedArray<16>::get_value(arr, index);
+    case 32:
+        return flbwt::FixedPackedArray<32>::get_value(arr, index);
+    }
+
     uint64_t abs_value;
     uint64_t arr_index;
     uint8_t bit_index;
     uint64_t bitmask1;
     uint8_t shift;
 
-    arr_index = this->integer_bits * index / 64;
-    bit_index = 63 - ((this->integer_bits * index) % 64);
+    arr_index = integer_bits * index / 64;
+    bit_index = 63 - ((integer_bits * index) % 64);
 
-    if (bit_index + 1 >= this->integer_bits) 
+    if (bit_index + 1 >= integer_bits) 
     { // Integer is not splitted
-        bitmask1 = BIT_MASK(uint64_t, this->integer_bits);
-        shift = bit_index + 1 - this->integer_bits;
-        abs_value = (this->arr[arr_index] >> shift) & bitmask1;
+        bitmask1 = BIT_MASK(uint64_t, integer_bits);
+        shift = bit_index + 1 - integer_bits;
+        abs_value = (arr[arr_index] >> shift) & bitmask1;
     }
     else 
     { // Integer is splitted
         bitmask1 = BIT_MASK(uint64_t, bit_index + 1);
-        shift = this->integer_bits - bit_index - 1;
-        abs_value = (this->arr[arr_index] & bitmask1) << shift;
-        abs_value = abs_value | (this->arr[arr_index + 1] >> (64 - shift));
+        shift = integer_bits - bit_index - 1;
+        abs_value = (arr[arr_index] & bitmask1) << shift;
+        abs_value = abs_value | (arr[arr_index + 1] >> (64 - shift));
     }
 
     return abs_value;
 }
 
+void flbwt::PackedArray::unpack(uint64_t index, uint64_t count, uint64_t *out)
+{
+    flbwt::PackedArray::unpack(this->arr, this->integer_bits, index, count, out);
+}
+
+void flbwt::PackedArray::pack(uint64_t index, uint64_t count, const uint64_t *in)
+{
+    flbwt::PackedArray::pack(this->arr, this->integer_bits, index, count, in);
+}
+
+void flbwt::PackedArray::unpack(const uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t count, uint64_t *out)
+{
+    switch (integer_bits)
+    {
+    case 8:
+        flbwt::FixedPackedArray<8>::unpack(arr, index, count, out);
+        return;
+    case 16:
+        flbwt::FixedPackedArray<16>::unpack(arr, index, count, out);
+        return;
+    case 32:
+        flbwt::FixedPackedArray<32>::unpack(arr, index, count, out);
+        return;
+    }
+
+    if (count == 0)
+        return;
+
+    flbwt::PackedArrayReader reader(arr, integer_bits, index);
+
+    for (uint64_t i = 0; i < count; i++)
+        out[i] = reader.next();
+}
+
+void flbwt::PackedArray::pack(uint64_t *arr, uint8_t integer_bits, uint64_t index, uint64_t count, const uint64_t *in)
+{
+    switch (integer_bits)
+    {
+    case 8:
+        flbwt::FixedPackedArray<8>::pack(arr, index, count, in);
+        return;
+    case 16:
+        flbwt::FixedPackedArray<16>::pack(arr, index, count, in);
+        return;
+    case 32:
+        flbwt::FixedPackedArray<32>::pack(arr, index, count, in);
+        return;
+    }
+
+    if (count == 0)
+        return;
+
+    flbwt::PackedArrayWriter writer(arr, integer_bits, index);
+
+    for (uint64_t i = 0; i < count; i++)
+        writer.put(in[i]);
+
+    writer.flush();
+}
+
+flbwt::PackedArrayReader::PackedArrayReader(const uint64_t *arr, uint8_t integer_bits, uint64_t index)
+{
+    uint64_t bit = index * integer_bits;
+    uint8_t offset = bit % 64;
+
+    this->p = arr + bit / 64;
+    this->word = *this->p++ << offset;
+    this->avail = 64 - offset;
+    this->bits = integer_bits;
+}
+
+flbwt::PackedArrayWriter::PackedArrayWriter(uint64_t *arr, uint8_t integer_bits, uint64_t index)
+{
+    uint64_t bit = index * integer_bits;
+
+    this->p = arr + bit / 64;
+    this->used = bit % 64;
+    this->word = *this->p & ~BIT_MASK(uint64_t, 64 - this->used); // keep the values before index
+    this->bits = integer_bits;
+}
+
+void flbwt::PackedArrayWriter::flush()
+{
+    if (this->used == 0)
+        return;
+
+    uint64_t keep = BIT_MASK(uint64_t, 64 - this->used);
+    *this->p = this->word | (*this->p & keep);
+}
+
 uint64_t *flbwt::PackedArray::get_raw_arr_pointer()
 {
     return this->arr;
@@ -87,5 +225,6 @@ uint64_t *flbwt::PackedArray::get_raw_arr_pointer()
 
 flbwt::PackedArray::~PackedArray()
 {
-    free(this->arr);
+    if (this->owns_arr)
+        flbwt::mem_free(this->arr);
 }
\ No newline at end of file
@@ -1,16 +1,211 @@
 #include <stddef.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "memory.hpp"
 #include "queue.hpp"
 #include "utility.hpp"
 
-flbwt::Queue::Queue(uint8_t w)
+flbwt::QueuePool::QueuePool(uint8_t w, uint64_t block_size)
 {
-    this->n = 0;
     this->w = w;
+    this->block_size = block_size;
+    this->block_words = flbwt::PackedArray::words_required(block_size, w);
+    this->num_of_blocks = 0;
+    this->free_blocks = NULL;
+    this->slabs = NULL;
+    this->scratch_fd = -1;
+    this->ram_budget = 0;
+    this->scratch_end = 0;
+    this->num_of_spilled_blocks = 0;
+    this->workspace = NULL;
+}
+
+/**
+ * @brief Size of a slab in bytes (link, block headers and values).
+ */
+static uint64_t slab_bytes(uint64_t block_words)
+{
+    return sizeof(uint64_t) + QSLAB_BLOCKS * (sizeof(flbwt::qblock) + block_words * sizeof(uint64_t));
+}
+
+flbwt::QueuePool::~QueuePool()
+{
+    void *slab = this->slabs;
+
+    while (slab != NULL)
+    {
+        void *next = *(void **)slab;
+        flbwt::mem_free(slab);
+        slab = next;
+    }
+
+    if (this->scratch_fd != -1)
+        close(this->scratch_fd);
+}
+
+flbwt::qblock *flbwt::QueuePool::allocate()
+{
+    flbwt::qblock *qb;
+
+    if (this->free_blocks == NULL)
+    { // carve a new slab: [link][QSLAB_BLOCKS qblocks][QSLAB_BLOCKS * block_words words]
+        uint64_t header = sizeof(uint64_t) + QSLAB_BLOCKS * sizeof(flbwt::qblock);
+        uint8_t *slab = NULL;
+
+        // slabs carved from the workspace are owned by it --> not linked to the list
+        if (this->workspace != NULL)
+            slab = (uint8_t *)this->workspace->carve(slab_bytes(this->block_words));
+
+        if (slab == NULL)
+        {
+            slab = (uint8_t *)flbwt::mem_alloc(slab_bytes(this->block_words));
+
+            if (slab == NULL)
+                throw std::bad_alloc();
+
+            *(void **)slab = this->slabs;
+            this->slabs = slab;
+        }
+
+        flbwt::qblock *blocks = (flbwt::qblock *)(slab + sizeof(uint64_t));
+        uint64_t *words = (uint64_t *)(slab + header);
+
+        for (uint64_t i = 0; i < QSLAB_BLOCKS; i++)
+        {
+            blocks[i].b = words + i * this->block_words;
+            blocks[i].next = this->free_blocks;
+            this->free_blocks = &blocks[i];
+        }
+
+        this->num_of_blocks += QSLAB_BLOCKS;
+    }
+
+    qb = this->free_blocks;
+    this->free_blocks = qb->next;
+
+    return qb;
+}
+
+void flbwt::QueuePool::release(flbwt::qblock *qb)
+{
+    qb->next = this->free_blocks;
+    this->free_blocks = qb;
+}
+
+uint8_t flbwt::QueuePool::get_width()
+{
+    return this->w;
+}
+
+uint64_t flbwt::QueuePool::get_block_size()
+{
+    return this->block_size;
+}
+
+uint64_t flbwt::QueuePool::get_num_of_blocks()
+{
+    return this->num_of_blocks;
+}
+
+void flbwt::QueuePool::set_scratch(const char *directory, uint64_t ram_budget)
+{
+    std::string path = std::string(directory) + "/flbwt-queue-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+
+    int fd = mkstemp(name.data());
+    if (fd == -1)
+        throw std::runtime_error("mkstemp failed(): Could not create scratch file");
+
+    // the file is only reachable through the descriptor from now on
+    unlink(name.data());
+
+    if (this->scratch_fd != -1)
+        close(this->scratch_fd);
+
+    this->scratch_fd = fd;
+    this->ram_budget = ram_budget;
+}
+
+void flbwt::QueuePool::set_workspace(flbwt::Workspace *workspace)
+{
+    this->workspace = workspace;
+}
+
+bool flbwt::QueuePool::must_spill()
+{
+    if (this->scratch_fd == -1 || this->free_blocks != NULL)
+        return false;
+
+    // carved slabs don't take the heap any further
+    if (this->workspace != NULL && this->workspace->can_carve(slab_bytes(this->block_words)))
+        return false;
+
+    return flbwt::mem_current() + (int64_t)slab_bytes(this->block_words) > (int64_t)this->ram_budget;
+}
+
+uint64_t flbwt::QueuePool::spill(const uint64_t *b)
+{
+    uint64_t offset;
+    uint64_t bytes = this->block_words * sizeof(uint64_t);
+
+    if (this->free_offsets.empty())
+    {
+        offset = this->scratch_end;
+        this->scratch_end += bytes;
+    }
+    else
+    {
+        offset = this->free_offsets.back();
+        this->free_offsets.pop_back();
+    }
+
+    if (pwrite(this->scratch_fd, b, bytes, offset) != (ssize_t)bytes)
+        throw std::runtime_error("pwrite failed(): Could not write scratch file");
+
+    this->num_of_spilled_blocks++;
+    return offset;
+}
+
+void flbwt::QueuePool::restore(uint64_t offset, uint64_t *b)
+{
+    uint64_t bytes = this->block_words * sizeof(uint64_t);
+
+    if (pread(this->scratch_fd, b, bytes, offset) != (ssize_t)bytes)
+        throw std::runtime_error("pread failed(): Could not read scratch file");
+
+    this->free_offsets.push_back(offset);
+}
+
+void flbwt::QueuePool::discard(uint64_t offset)
+{
+    this->free_offsets.push_back(offset);
+}
+
+uint64_t flbwt::QueuePool::get_num_of_spilled_blocks()
+{
+    return this->num_of_spilled_blocks;
+}
+
+flbwt::Queue::Queue(uint8_t w) : Queue(new flbwt::QueuePool(w))
+{
+    this->owns_pool = true;
+}
+
+flbwt::Queue::Queue(flbwt::QueuePool *pool)
+{
+    this->n = 0;
+    this->w = pool->get_width();
+    this->pool = pool;
+    this->owns_pool = false;
+    this->bsize = pool->get_block_size();
     this->sb = NULL;
     this->eb = NULL;
     this->s_ofs = 0;
-    this->e_ofs = QSIZ - 1;
+    this->e_ofs = this->bsize - 1;
 }
 
 flbwt::Queue::~Queue()
@@ -22,22 +217,30 @@ flbwt::Queue::~Queue()
     while (qb != NULL)
     {
         q = qb->next;
-
-        delete qb->b;
-        free(qb);
-
+        this->pool->release(qb);
         qb = q;
     }
+
+    for (uint64_t i = 0; i < this->spilled.size(); i++)
+        this->pool->discard(this->spilled[i]);
+
+    if (this->owns_pool)
+        delete this->pool;
 }
 
 void flbwt::Queue::enqueue(uint64_t x)
 {
     qblock *qb;
 
-    if (this->e_ofs == QSIZ - 1)
+    if (this->e_ofs == this->bsize - 1 && this->eb != this->sb &&
+        (!this->spilled.empty() || this->pool->must_spill()))
+    { // current block is full --> move its values to the scratch file and reuse it
+        this->spilled.push_back(this->pool->spill(this->eb->b));
+        this->e_ofs = -1;
+    }
+    else if (this->e_ofs == this->bsize - 1)
     { // current block is full
-        qb = (qblock *)malloc(sizeof(qblock));
-        qb->b = new PackedArray(QSIZ, this->w);
+        qb = this->pool->allocate();
 
         if (this->eb == NULL)
         { // no blocks
@@ -56,23 +259,65 @@ void flbwt::Queue::enqueue(uint64_t x)
         this->e_ofs = -1;
     }
 
-    this->eb->b->set_value(++this->e_ofs, x);
+    flbwt::PackedArray::set_value(this->eb->b, this->w, ++this->e_ofs, x);
     this->n++;
 }
 
+void flbwt::Queue::enqueue(const uint64_t *x, uint64_t count)
+{
+    while (count > 0)
+    {
+        if (this->e_ofs == this->bsize - 1)
+        { // let the single value path link a new block
+            this->enqueue(*x++);
+            count--;
+            continue;
+        }
+
+        // fill the rest of the current block in one go
+        uint64_t k = this->bsize - 1 - this->e_ofs;
+        if (k > count)
+            k = count;
+
+        flbwt::PackedArray::pack(this->eb->b, this->w, this->e_ofs + 1, k, x);
+
+        this->e_ofs += k;
+        this->n += k;
+        x += k;
+        count -= k;
+    }
+}
+
 void flbwt::Queue::enqueue_l(uint64_t x)
 {
     qblock *qb;
 
-    if (this->s_ofs == 0)
+    if (this->s_ofs == 0 && this->sb != this->eb && this->pool->must_spill())
+    { // current block is full --> move the (full) block preceding the spilled ones
+      // to the scratch file and reuse it as the first block
+        qb = this->eb->prev;
+        this->spilled.push_front(this->pool->spill(qb->b));
+
+        if (qb != this->sb)
+        {
+            qb->prev->next = this->eb;
+            this->eb->prev = qb->prev;
+            qb->prev = NULL;
+            qb->next = this->sb;
+            this->sb->prev = qb;
+            this->sb = qb;
+        }
+
+        this->s_ofs = this->bsize;
+    }
+    else if (this->s_ofs == 0)
     { // current block is full
-        qb = (qblock *)malloc(sizeof(qblock));
-        qb->b = new PackedArray(QSIZ, this->w);
+        qb = this->pool->allocate();
 
         if (this->sb == NULL)
         { // no block exists
             this->sb = this->eb = qb;
-            this->e_ofs = QSIZ - 1;
+            this->e_ofs = this->bsize - 1;
             qb->prev = qb->next = NULL;
         }
         else
@@ -83,44 +328,93 @@ void flbwt::Queue::enqueue_l(uint64_t x)
             this->sb = qb;
         }
 
-        this->s_ofs = QSIZ;
+        this->s_ofs = this->bsize;
     }
 
-    this->sb->b->set_value(--this->s_ofs, x);
+    flbwt::PackedArray::set_value(this->sb->b, this->w, --this->s_ofs, x);
     this->n++;
 }
 
-int64_t flbwt::Queue::dequeue()
+void flbwt::Queue::drop_first_block()
 {
-    qblock *qb;
+    if (this->sb->next == this->eb && !this->spilled.empty())
+    { // the spilled blocks come next --> read the first one into the block
+        this->pool->restore(this->spilled.front(), this->sb->b);
+        this->spilled.pop_front();
+        this->s_ofs = 0;
+        return;
+    }
 
-    int64_t x = this->sb->b->get_value(this->s_ofs++);
+    qblock *qb = this->sb;
+    this->sb = qb->next;
+    this->pool->release(qb);
 
-    if (this->s_ofs == QSIZ)
-    { // current block is empty
-        qb = this->sb;
-        this->sb = qb->next;
-        delete qb->b;
-        free(qb);
+    if (this->sb == NULL)
+    { // the block is gone
+        this->eb = NULL;
+        this->e_ofs = this->bsize - 1;
+        this->s_ofs = 0;
+    }
+    else
+    {
+        this->sb->prev = NULL;
+        this->s_ofs = 0;
+    }
+}
 
-        if (this->sb == NULL)
-        { // the block is gone
-            this->eb = NULL;
-            this->e_ofs = QSIZ - 1;
-            this->s_ofs = 0;
-        }
-        else
-        {
-            this->sb->prev = NULL;
-            this->s_ofs = 0;
-        }
+int64_t flbwt::Queue::dequeue()
+{
+    int64_t x = flbwt::PackedArray::get_value(this->sb->b, this->w, this->s_ofs++);
+
+    if (this->s_ofs == this->bsize)
+    { // current block is empty
+        this->drop_first_block();
     }
 
     this->n--;
     return x;
 }
 
+uint64_t flbwt::Queue::dequeue(uint64_t *x, uint64_t count)
+{
+    uint64_t removed = 0;
+
+    if (count > this->n)
+        count = this->n;
+
+    while (removed < count)
+    {
+        // take values up to the end of the first block (or of the queue)
+        uint64_t k = this->bsize - this->s_ofs;
+        if (k > count - removed)
+            k = count - removed;
+
+        flbwt::PackedArray::unpack(this->sb->b, this->w, this->s_ofs, k, x + removed);
+
+        this->s_ofs += k;
+        this->n -= k;
+        removed += k;
+
+        if (this->s_ofs == this->bsize)
+        { // current block is empty
+            this->drop_first_block();
+        }
+    }
+
+    return removed;
+}
+
 bool flbwt::Queue::is_empty()
 {
     return this->n == 0;
-}
\ No newline at end of file
+}
+
+uint64_t flbwt::Queue::size()
+{
+    return this->n;
+}
+
+flbwt::QueuePool *flbwt::Queue::get_pool()
+{
+    return this->pool;
+}
@@ -0,0 +1,746 @@
+#include <stddef.h>
+#include <vector>
+#include "sais.hpp"
+#include "sais32bit.hpp"
+#include "sais64bit.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+#define SAIS_PARALLEL_MIN 65536 // shorter strings are processed serially
+#define SAIS_COUNTS_RATIO 64    // per-thread count tables must be this many times smaller than the string
+#define SAIS_BLOCK 65536        // entries of SA read ahead in parallel by induce_SA
+
+#ifdef FLBWT_PREFETCH
+#define SAIS_PREFETCH_DISTANCE 32 // entries of SA between a prefetch and its use in induce_SA
+#endif
+
+/**
+ * @brief Input string packed into 64-bit words (first level of recursion).
+ */
+struct PackedText
+{
+    const uint64_t *B;
+    uint8_t d;
+    uint64_t mask;
+
+    PackedText(const uint64_t *B, uint8_t d) : B(B), d(d)
+    {
+        this->mask = (d == 64) ? ~(uint64_t)0 : ((uint64_t)1 << d) - 1;
+    }
+
+    uint64_t operator[](int64_t i) const
+    {
+        // same layout as PackedArray: most significant bits first
+        uint64_t bit = (uint64_t)this->d * (i + 1);
+        uint64_t w = bit >> 6;
+        uint8_t end = (bit & 63) + this->d;
+
+        if (end <= 64)
+            return (this->B[w] >> (64 - end)) & this->mask;
+
+        return ((this->B[w] << (end - 64)) | (this->B[w + 1] >> (128 - end))) & this->mask;
+    }
+
+    void prefetch(int64_t i) const
+    {
+        __builtin_prefetch(this->B + (((uint64_t)this->d * (i + 1)) >> 6));
+    }
+};
+
+/**
+ * @brief Input string stored in suffix array storage (reduced problems).
+ */
+template <class Storage>
+struct StorageText
+{
+    Storage A;
+
+    StorageText(Storage A) : A(A) {}
+
+    uint64_t operator[](int64_t i) const
+    {
+        return this->A.get(i);
+    }
+
+    void prefetch(int64_t i) const
+    {
+        this->A.prefetch(i);
+    }
+};
+
+/**
+ * @brief Call f(T[i]) for i = begin..end-1.
+ */
+template <class Text, class Func>
+static void scan(const Text &T, uint64_t begin, uint64_t end, Func f)
+{
+    for (uint64_t i = begin; i < end; ++i)
+        f(T[i]);
+}
+
+/**
+ * @brief Call f(T[i]) for i = begin..end-1 (packed string read sequentially).
+ */
+template <class Func>
+static void scan(const PackedText &T, uint64_t begin, uint64_t end, Func f)
+{
+    flbwt::PackedArrayReader reader(T.B, T.d, begin + 1);
+
+    for (uint64_t i = begin; i < end; ++i)
+        f(reader.next());
+}
+
+/**
+ * @brief Get the count of each character in the input string.
+ * Threads count their own part of the string into private tables when the
+ * tables are small compared to the string, otherwise the string is counted serially.
+ */
+template <class Text, class Storage>
+static void get_counts(const Text &T, Storage C, uint64_t n, uint64_t k, flbwt::ThreadPool *pool)
+{
+    unsigned threads = (pool == NULL || n < SAIS_PARALLEL_MIN) ? 1 : pool->size();
+
+    if (threads > 1 && threads * k <= n / SAIS_COUNTS_RATIO)
+    {
+        std::vector<uint64_t> counts(threads * k, 0);
+
+        pool->run([&](unsigned t) {
+            uint64_t *count = &counts[t * k];
+            scan(T, n * t / threads, n * (t + 1) / threads, [&](uint64_t c) { count[c]++; });
+        });
+
+        pool->parallel_for(k, [&](uint64_t begin, uint64_t end) {
+            for (uint64_t c = begin; c < end; ++c)
+            {
+                uint64_t sum = 0;
+                for (unsigned t = 0; t < threads; ++t)
+                    sum += counts[t * k + c];
+                C.set(c, sum);
+            }
+        });
+
+        return;
+    }
+
+    for (uint64_t i = 0; i < k; ++i)
+        C.set(i, 0);
+
+    scan(T, 0, n, [&](uint64_t c) { C.set(c, C.get(c) + 1); });
+}
+
+/**
+ * @brief Return 1 if T[i] is S-type and 0 if it is L-type (T[n - 1] is L-type).
+ */
+template <class Text>
+static int64_t get_type(const Text &T, uint64_t n, uint64_t i)
+{
+    while (i + 1 < n && T[i] == T[i + 1])
+        ++i;
+
+    return (i + 1 < n && T[i] < T[i + 1]) ? 1 : 0;
+}
+
+/**
+ * @brief Mark the LMS (S*) positions of T in a bit vector.
+ * Every thread marks the positions of its own words, the type of the first
+ * character after its range is found by scanning forward.
+ */
+template <class Text>
+static void mark_LMS(const Text &T, uint64_t n, std::vector<uint64_t> &LMS, flbwt::ThreadPool *pool)
+{
+    uint64_t words = n / 64 + 1;
+
+    LMS.assign(words, 0);
+
+    auto mark = [&](uint64_t begin, uint64_t end) {
+        int64_t lo = begin * 64;
+        int64_t hi = (end * 64 < n) ? end * 64 : n;
+        int64_t c;
+        int64_t c0;
+        int64_t c1;
+        int64_t i;
+
+        if (hi <= lo)
+            return;
+
+        if (hi == (int64_t)n)
+        {
+            c = 0;
+            c1 = T[n - 1];
+            i = n - 2;
+        }
+        else
+        {
+            c = get_type(T, n, hi);
+            c1 = T[hi];
+            i = hi - 1;
+        }
+
+        // i + 1 is an LMS position when i is L-type and i + 1 is S-type
+        for (; 0 <= i && lo - 1 <= i; --i, c1 = c0)
+        {
+            c0 = T[i];
+
+            if (c0 < c1 + c)
+            {
+                c = 1;
+            }
+            else if (c != 0)
+            {
+                if (i + 1 < hi)
+                    LMS[(i + 1) >> 6] |= (uint64_t)1 << ((i + 1) & 63);
+                c = 0;
+            }
+        }
+    };
+
+    if (pool == NULL || n < SAIS_PARALLEL_MIN)
+        mark(0, words);
+    else
+        pool->parallel_for(words, mark);
+}
+
+/**
+ * @brief Call f(p) for every LMS position p, from right to left. Without a
+ * marked bit vector (serial path) the types are scanned again.
+ */
+template <class Text, class Func>
+static void for_each_LMS(const Text &T, uint64_t n, const std::vector<uint64_t> &LMS, Func f)
+{
+    if (LMS.empty())
+    {
+        int64_t c = 0;
+        int64_t c0;
+        int64_t c1 = T[n - 1];
+
+        for (int64_t i = n - 2; 0 <= i; --i, c1 = c0)
+        {
+            c0 = T[i];
+
+            if (c0 < c1 + c)
+            {
+                c = 1;
+            }
+            else if (c != 0)
+            {
+                f(i + 1);
+                c = 0;
+            }
+        }
+
+        return;
+    }
+
+    for (uint64_t w = LMS.size(); w-- > 0;)
+    {
+        uint64_t bits = LMS[w];
+
+        while (bits != 0)
+        {
+            uint8_t h = 63 - __builtin_clzll(bits);
+            f((int64_t)(w * 64 + h));
+            bits &= ~((uint64_t)1 << h);
+        }
+    }
+}
+
+/**
+ * @brief Return true if p is an LMS position (bit vector or, if it is empty, the types of T).
+ */
+template <class Text>
+static bool is_LMS(const Text &T, uint64_t n, const std::vector<uint64_t> &LMS, int64_t p)
+{
+    if (LMS.empty())
+        return 0 < p && T[p - 1] > T[p] && get_type(T, n, p) == 1;
+
+    return (LMS[p >> 6] >> (p & 63)) & 1;
+}
+
+/**
+ * @brief Find the start or end of each bucket.
+ */
+template <class Storage>
+static void get_buckets(Storage C, Storage B, uint64_t k, bool end)
+{
+    int64_t sum = 0;
+
+    if (end)
+    {
+        for (uint64_t i = 0; i < k; ++i)
+        {
+            sum += C.get(i);
+            B.set(i, sum);
+        }
+    }
+    else
+    {
+        for (uint64_t i = 0; i < k; ++i)
+        {
+            int64_t value = C.get(i);
+            B.set(i, sum);
+            sum += value;
+        }
+    }
+}
+
+#ifdef FLBWT_PREFETCH
+/**
+ * @brief Prefetch the character before the suffix in SA[i] (i < n).
+ */
+template <class Text, class Storage>
+static inline void prefetch_text(const Text &T, Storage SA, int64_t i, uint64_t n)
+{
+    if (0 <= i && i < (int64_t)n)
+    {
+        int64_t j = SA.get(i);
+        if (0 < j)
+            T.prefetch(j - 1);
+    }
+}
+#endif
+
+/**
+ * @brief Induce SA.
+ *
+ * With a thread pool every pass runs in blocks of SAIS_BLOCK entries: the
+ * threads read a block of SA and look up the characters and values for its
+ * entries, then the block is committed serially. Entries that were changed
+ * by the commit of their own block since they were read are recomputed.
+ */
+template <class Text, class Storage>
+static void induce_SA(const Text &T, Storage SA, Storage C, Storage B, uint64_t n, uint64_t k, flbwt::ThreadPool *pool)
+{
+    bool parallel = (pool != NULL && pool->size() > 1 && SAIS_PARALLEL_MIN <= n);
+    std::vector<int64_t> read;
+    std::vector<int64_t> value;
+    std::vector<uint64_t> chars;
+    int64_t j;
+    int64_t c0;
+    int64_t c1;
+    int64_t b;
+
+    if (parallel)
+    {
+        read.resize(SAIS_BLOCK);
+        value.resize(SAIS_BLOCK);
+        chars.resize(SAIS_BLOCK);
+    }
+
+    // compute SA1
+    if (C == B)
+    {
+        get_counts(T, C, n, k, pool);
+    }
+
+    get_buckets(C, B, k, false);
+
+    j = n - 1;
+    c1 = T[j];
+    b = B.get(c1);
+
+    SA.set(b++, ((0 < j) && (T[j - 1] < (uint64_t)c1)) ? ~j : j);
+
+    if (parallel)
+    {
+        for (uint64_t s = 0; s < n; s += SAIS_BLOCK)
+        {
+            uint64_t e = (s + SAIS_BLOCK < n) ? s + SAIS_BLOCK : n;
+
+            pool->parallel_for(e - s, [&](uint64_t begin, uint64_t end) {
+                for (uint64_t x = begin; x < end; ++x)
+                {
+                    int64_t p = read[x] = SA.get(s + x);
+
+                    if (0 < p)
+                    {
+                        --p;
+                        uint64_t c = chars[x] = T[p];
+                        value[x] = ((0 < p) && (T[p - 1] < c)) ? ~p : p;
+                    }
+                }
+            });
+
+            for (uint64_t i = s; i < e; ++i)
+            {
+                int64_t v;
+
+                j = SA.get(i);
+                SA.set(i, ~j);
+
+                if (0 < j)
+                {
+                    if (j == read[i - s])
+                    {
+                        c0 = chars[i - s];
+                        v = value[i - s];
+                    }
+                    else
+                    {
+                        --j;
+                        c0 = T[j];
+                        v = ((0 < j) && (T[j - 1] < (uint64_t)c0)) ? ~j : j;
+                    }
+
+                    if (c0 != c1)
+                    {
+                        B.set(c1, b);
+                        c1 = c0;
+                        b = B.get(c1);
+                    }
+
+                    SA.set(b++, v);
+                }
+            }
+        }
+    }
+    else
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+#ifdef FLBWT_PREFETCH
+            prefetch_text(T, SA, i + SAIS_PREFETCH_DISTANCE, n);
+#endif
+            j = SA.get(i);
+            SA.set(i, ~j);
+
+            if (0 < j)
+            {
+                --j;
+                c0 = T[j];
+                if (c0 != c1)
+                {
+                    B.set(c1, b);
+                    c1 = c0;
+                    b = B.get(c1);
+                }
+
+                SA.set(b++, ((0 < j) && (T[j - 1] < (uint64_t)c1)) ? ~j : j);
+            }
+        }
+    }
+
+    // compute the SAs
+    if (C == B)
+    {
+        get_counts(T, C, n, k, pool);
+    }
+
+    get_buckets(C, B, k, true);
+
+    c1 = 0;
+    b = B.get(c1);
+
+    if (parallel)
+    {
+        for (uint64_t e = n; 0 < e;)
+        {
+            uint64_t s = (SAIS_BLOCK < e) ? e - SAIS_BLOCK : 0;
+
+            pool->parallel_for(e - s, [&](uint64_t begin, uint64_t end) {
+                for (uint64_t x = begin; x < end; ++x)
+                {
+                    int64_t p = read[x] = SA.get(s + x);
+
+                    if (0 < p)
+                    {
+                        --p;
+                        uint64_t c = chars[x] = T[p];
+                        value[x] = ((p == 0) || (T[p - 1] > c)) ? ~p : p;
+                    }
+                }
+            });
+
+            for (int64_t i = e - 1; (int64_t)s <= i; --i)
+            {
+                int64_t v;
+
+                j = SA.get(i);
+
+                if (0 < j)
+                {
+                    if (j == read[i - s])
+                    {
+                        c0 = chars[i - s];
+                        v = value[i - s];
+                    }
+                    else
+                    {
+                        --j;
+                        c0 = T[j];
+                        v = ((j == 0) || (T[j - 1] > (uint64_t)c0)) ? ~j : j;
+                    }
+
+                    if (c0 != c1)
+                    {
+                        B.set(c1, b);
+                        c1 = c0;
+                        b = B.get(c1);
+                    }
+
+                    SA.set(--b, v);
+                }
+                else
+                {
+                    SA.set(i, ~j);
+                }
+            }
+
+            e = s;
+        }
+    }
+    else
+    {
+        for (int64_t i = n - 1; 0 <= i; --i)
+        {
+#ifdef FLBWT_PREFETCH
+            prefetch_text(T, SA, i - SAIS_PREFETCH_DISTANCE, n);
+#endif
+            j = SA.get(i);
+
+            if (0 < j)
+            {
+                --j;
+                c0 = T[j];
+                if (c0 != c1)
+                {
+                    B.set(c1, b);
+                    c1 = c0;
+                    b = B.get(c1);
+                }
+
+                SA.set(--b, ((j == 0) || (T[j - 1] > (uint64_t)c1)) ? ~j : j);
+            }
+            else
+            {
+                SA.set(i, ~j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief SAIS over input string T, recursion works on the storage itself.
+ */
+template <class Text, class Storage>
+static void sais_main(const Text &T, Storage SA, uint64_t fs, uint64_t n, uint64_t k, flbwt::ThreadPool *pool)
+{
+    std::vector<uint64_t> LMS;
+    Storage C;
+    Storage B;
+    Storage RA;
+    int64_t m;
+    int64_t p;
+    int64_t j;
+    int64_t name;
+    int64_t q;
+    int64_t qlen;
+    int64_t plen;
+    int64_t diff;
+
+    // STAGE 1: reduce the problem by at least 1/2 sort all the S-substrings
+    if (k <= fs)
+    {
+        C = SA + n;
+        B = (k <= (fs - k)) ? C + k : C;
+    }
+    else
+    {
+        C = B = Storage::allocate(k);
+    }
+
+    get_counts(T, C, n, k, pool);
+    get_buckets(C, B, k, true);
+
+    for (uint64_t i = 0; i < n; ++i)
+        SA.set(i, 0);
+
+    // only the threads work on the bit vector, the serial path scans the types
+    bool marked = (pool != NULL && SAIS_PARALLEL_MIN <= n);
+
+    if (marked)
+        mark_LMS(T, n, LMS, pool);
+    for_each_LMS(T, n, LMS, [&](int64_t p) {
+        int64_t c = T[p];
+        int64_t index = B.get(c) - 1;
+        B.set(c, index);
+        SA.set(index, p);
+    });
+
+    induce_SA(T, SA, C, B, n, k, pool);
+
+    if (fs < k)
+        C.release();
+
+    // compact all the sorted substrings into the first m items of SA
+    m = 0;
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        p = SA.get(i);
+
+        if (0 < p && is_LMS(T, n, LMS, p))
+            SA.set(m++, p);
+    }
+
+    // int the name array buffer
+    for (uint64_t i = m; i < n; ++i)
+        SA.set(i, 0);
+
+    // store the length of all substrings
+    j = n;
+    for_each_LMS(T, n, LMS, [&](int64_t p) {
+        SA.set(m + (p >> 1), j - p);
+        j = p;
+    });
+
+    // find the lexicographic names of all substrings
+    name = 0;
+    q = n;
+    qlen = 0;
+    for (int64_t i = 0; i < m; ++i)
+    {
+        p = SA.get(i);
+        int64_t index = m + (p >> 1);
+        plen = SA.get(index);
+        diff = 1;
+
+        if (plen == qlen)
+        {
+            for (j = 0; j < plen; ++j)
+            {
+                if (T[p + j] != T[q + j])
+                    break;
+            }
+
+            if (j == plen)
+                diff = 0;
+        }
+
+        if (diff != 0)
+        {
+            ++name;
+            q = p;
+            qlen = plen;
+        }
+
+        SA.set(index, name);
+    }
+
+    // STAGE 2: Solve the reduced problem. Recurse if names are not yet unique
+    if (name < m)
+    {
+        RA = SA + (n + fs - m);
+        for (int64_t i = n - 1, j = m - 1; m <= i; --i)
+        {
+            int64_t value = SA.get(i);
+
+            if (value != 0)
+                RA.set(j--, value - 1);
+        }
+
+        // the bit vector is rebuilt after the recursion instead of being kept through it
+        std::vector<uint64_t>().swap(LMS);
+        sais_main(StorageText<Storage>(RA), SA, fs + n - m * 2, m, name, pool);
+
+        if (marked)
+            mark_LMS(T, n, LMS, pool);
+        j = m - 1;
+        for_each_LMS(T, n, LMS, [&](int64_t p) { RA.set(j--, p); });
+
+        for (int64_t i = 0; i < m; ++i)
+            SA.set(i, RA.get(SA.get(i)));
+    }
+
+    // STAGE 3: Induce the result for the original probelm
+    if (k <= fs)
+    {
+        C = SA + n;
+        B = (k <= (fs - k)) ? C + k : C;
+    }
+    else
+    {
+        C = B = Storage::allocate(k);
+    }
+
+    // put all LMS characters into their buckets
+    get_counts(T, C, n, k, pool);
+    get_buckets(C, B, k, true);
+
+    for (uint64_t i = m; i < n; ++i)
+        SA.set(i, 0);
+
+    for (int64_t i = m - 1; 0 <= i; --i)
+    {
+        j = SA.get(i);
+        SA.set(i, 0);
+        int64_t c = T[j];
+        int64_t index = B.get(c) - 1;
+        B.set(c, index);
+        SA.set(index, j);
+    }
+
+    induce_SA(T, SA, C, B, n, k, pool);
+
+    if (fs < k)
+        C.release();
+}
+
+template <class Storage>
+void flbwt::sais(const uint64_t *T, uint8_t cs, Storage SA, uint64_t fs, uint64_t n, uint64_t k, unsigned threads)
+{
+    if (threads > 1 && SAIS_PARALLEL_MIN <= n)
+    {
+        flbwt::ThreadPool pool(threads);
+        sais_main(PackedText(T, cs), SA, fs, n, k, &pool);
+    }
+    else
+    {
+        sais_main(PackedText(T, cs), SA, fs, n, k, NULL);
+    }
+}
+
+template void flbwt::sais<flbwt::SAStorage32>(const uint64_t *, uint8_t, flbwt::SAStorage32, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStorage40>(const uint64_t *, uint8_t, flbwt::SAStorage40, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStorage48>(const uint64_t *, uint8_t, flbwt::SAStorage48, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStorage56>(const uint64_t *, uint8_t, flbwt::SAStorage56, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStorage64>(const uint64_t *, uint8_t, flbwt::SAStorage64, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStoragePacked40>(const uint64_t *, uint8_t, flbwt::SAStoragePacked40, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStoragePacked48>(const uint64_t *, uint8_t, flbwt::SAStoragePacked48, uint64_t, uint64_t, uint64_t, unsigned);
+template void flbwt::sais<flbwt::SAStoragePacked56>(const uint64_t *, uint8_t, flbwt::SAStoragePacked56, uint64_t, uint64_t, uint64_t, unsigned);
+
+void flbwt::sais_32bit(const uint8_t *T, int32_t *SA, uint64_t fs, uint64_t n, uint64_t k, uint8_t cs)
+{
+    flbwt::sais((const uint64_t *)T, cs, flbwt::SAStorage32(SA), fs, n, k);
+}
+
+void flbwt::sais_40bit(const uint8_t *T, uint32_t *TA_L, int8_t *TA_U, uint32_t *SA_L,
+                       int8_t *SA_U, uint64_t fs, uint64_t n, uint64_t k, uint8_t cs)
+{
+    if (T != NULL)
+        flbwt::sais((const uint64_t *)T, cs, flbwt::SAStorage40(SA_L, SA_U), fs, n, k);
+    else
+        sais_main(StorageText<flbwt::SAStorage40>(flbwt::SAStorage40(TA_L, TA_U)), flbwt::SAStorage40(SA_L, SA_U), fs, n, k, NULL);
+}
+
+void flbwt::sais_48bit(const uint8_t *T, uint32_t *TA_L, int16_t *TA_U, uint32_t *SA_L,
+                       int16_t *SA_U, uint64_t fs, uint64_t n, uint64_t k, uint8_t cs)
+{
+    if (T != NULL)
+        flbwt::sais((const uint64_t *)T, cs, flbwt::SAStorage48(SA_L, SA_U), fs, n, k);
+    else
+        sais_main(StorageText<flbwt::SAStorage48>(flbwt::SAStorage48(TA_L, TA_U)), flbwt::SAStorage48(SA_L, SA_U), fs, n, k, NULL);
+}
+
+void flbwt::sais_56bit(const uint8_t *T, uint32_t *TA_L, uint16_t *TA_M, int8_t *TA_U, uint32_t *SA_L,
+                       uint16_t *SA_M, int8_t *SA_U, uint64_t fs, uint64_t n, uint64_t k, uint8_t cs)
+{
+    if (T != NULL)
+        flbwt::sais((const uint64_t *)T, cs, flbwt::SAStorage56(SA_L, SA_M, SA_U), fs, n, k);
+    else
+        sais_main(StorageText<flbwt::SAStorage56>(flbwt::SAStorage56(TA_L, TA_M, TA_U)),
+                  flbwt::SAStorage56(SA_L, SA_M, SA_U), fs, n, k, NULL);
+}
+
+void flbwt::sais_64bit(const uint8_t *T, int64_t *SA, uint64_t fs, uint64_t n, uint64_t k, uint8_t cs)
+{
+    flbwt::sais((const uint64_t *)T, cs, flbwt::SAStorage64(SA), fs, n, k);
+}
@@ -0,0 +1,96 @@
+#include "memory.hpp"
+#include "stats.hpp"
+
+flbwt::Stats::Stats()
+{
+    this->reset();
+}
+
+void flbwt::Stats::reset()
+{
+    this->num_of_substrings = 0;
+    this->num_of_unique_substrings = 0;
+    this->sa_bits = 0;
+    this->hash_collisions = 0;
+    this->queue_blocks = 0;
+    this->spilled_blocks = 0;
+
+    for (int i = 0; i < NUM_OF_PHASES; i++)
+    {
+        this->cpu_start[i] = 0;
+        this->wall_time[i] = 0;
+        this->cpu_time[i] = 0;
+        this->peak_memory[i] = 0;
+    }
+}
+
+void flbwt::Stats::start(flbwt::Phase phase)
+{
+    this->wall_start[phase] = std::chrono::steady_clock::now();
+    this->cpu_start[phase] = clock();
+    flbwt::mem_reset_peak();
+}
+
+void flbwt::Stats::stop(flbwt::Phase phase)
+{
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - this->wall_start[phase];
+
+    this->wall_time[phase] += wall.count();
+    this->cpu_time[phase] += (double)(clock() - this->cpu_start[phase]) / CLOCKS_PER_SEC;
+
+    if (flbwt::mem_peak() > this->peak_memory[phase])
+        this->peak_memory[phase] = flbwt::mem_peak();
+}
+
+double flbwt::Stats::get_wall_time(flbwt::Phase phase)
+{
+    return this->wall_time[phase];
+}
+
+double flbwt::Stats::get_cpu_time(flbwt::Phase phase)
+{
+    return this->cpu_time[phase];
+}
+
+int64_t flbwt::Stats::get_peak_memory(flbwt::Phase phase)
+{
+    return this->peak_memory[phase];
+}
+
+int64_t flbwt::Stats::get_peak_memory()
+{
+    int64_t peak = 0;
+
+    for (int i = 0; i < NUM_OF_PHASES; i++)
+    {
+        if (this->peak_memory[i] > peak)
+            peak = this->peak_memory[i];
+    }
+
+    return peak;
+}
+
+const char *flbwt::Stats::get_phase_name(flbwt::Phase phase)
+{
+    static const char *names[NUM_OF_PHASES] = {"extract", "sort", "shorten", "sais", "induce", "write"};
+    return names[phase];
+}
+
+void flbwt::Stats::print(std::ostream &out)
+{
+    for (int i = 0; i < NUM_OF_PHASES; i++)
+    {
+        flbwt::Phase phase = (flbwt::Phase)i;
+        out << flbwt::Stats::get_phase_name(phase) << ": " << this->wall_time[i] << " s wall, "
+            << this->cpu_time[i] << " s cpu, " << this->peak_memory[i] << " bytes peak" << std::endl;
+    }
+
+    out << "peak memory: " << this->get_peak_memory() << " bytes" << std::endl;
+
+    out << "S* substrings: " << this->num_of_substrings << std::endl;
+    out << "unique S* substrings: " << this->num_of_unique_substrings << std::endl;
+    out << "SA width: " << (int)this->sa_bits << " bits" << std::endl;
+    out << "hash collisions: " << this->hash_collisions << std::endl;
+    out << "queue blocks: " << this->queue_blocks << std::endl;
+    out << "spilled queue blocks: " << this->spilled_blocks << std::endl;
+}
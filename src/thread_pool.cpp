@@ -0,0 +1,95 @@
+#include "thread_pool.hpp"
+
+flbwt::ThreadPool::ThreadPool(unsigned threads)
+{
+    this->task = NULL;
+    this->generation = 0;
+    this->pending = 0;
+    this->stop = false;
+
+    for (unsigned t = 1; t < threads; t++)
+        this->workers.push_back(std::thread(&flbwt::ThreadPool::work, this, t));
+}
+
+flbwt::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stop = true;
+    }
+
+    this->started.notify_all();
+
+    for (uint64_t t = 0; t < this->workers.size(); t++)
+        this->workers[t].join();
+}
+
+unsigned flbwt::ThreadPool::size()
+{
+    return this->workers.size() + 1;
+}
+
+void flbwt::ThreadPool::run(const std::function<void(unsigned)> &task)
+{
+    if (this->workers.empty())
+    {
+        task(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->task = &task;
+        this->pending = this->workers.size();
+        this->generation++;
+    }
+
+    this->started.notify_all();
+    task(0);
+
+    std::unique_lock<std::mutex> guard(this->lock);
+    while (this->pending != 0)
+        this->finished.wait(guard);
+    this->task = NULL;
+}
+
+void flbwt::ThreadPool::parallel_for(uint64_t n, const std::function<void(uint64_t, uint64_t)> &task)
+{
+    unsigned threads = this->size();
+
+    this->run([&](unsigned t) {
+        uint64_t begin = n * t / threads;
+        uint64_t end = n * (t + 1) / threads;
+
+        if (begin < end)
+            task(begin, end);
+    });
+}
+
+void flbwt::ThreadPool::work(unsigned t)
+{
+    uint64_t seen = 0;
+
+    while (true)
+    {
+        const std::function<void(unsigned)> *task;
+
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            while (!this->stop && this->generation == seen)
+                this->started.wait(guard);
+
+            if (this->stop)
+                return;
+
+            seen = this->generation;
+            task = this->task;
+        }
+
+        (*task)(t);
+
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (--this->pending == 0)
+            this->finished.notify_one();
+    }
+}
@@ -0,0 +1,129 @@
+#include <new>
+#include <stdexcept>
+#include "memory.hpp"
+#include "workspace.hpp"
+
+flbwt::Workspace::Workspace()
+{
+}
+
+flbwt::Workspace::~Workspace()
+{
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+    {
+        delete[] this->arenas[i].p;
+        flbwt::mem_untrack(this->arenas[i].bytes);
+    }
+}
+
+uint64_t flbwt::Workspace::find(void *p)
+{
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+    {
+        if (this->arenas[i].p == p)
+            return i;
+    }
+
+    throw std::invalid_argument("Workspace failed(): Pointer is not an arena of the workspace");
+}
+
+void *flbwt::Workspace::acquire(uint64_t bytes)
+{
+    uint64_t best = this->arenas.size();
+
+    // smallest fitting arena --> large ones are kept for large requests
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+    {
+        Arena &a = this->arenas[i];
+
+        if (a.in_use || a.carved != 0 || a.bytes < bytes)
+            continue;
+
+        if (best == this->arenas.size() || a.bytes < this->arenas[best].bytes)
+            best = i;
+    }
+
+    if (best == this->arenas.size())
+    {
+        Arena a;
+        a.p = new uint8_t[bytes == 0 ? 1 : bytes];
+        a.bytes = bytes;
+        a.carved = 0;
+        a.in_use = false;
+        flbwt::mem_track(bytes);
+        this->arenas.push_back(a);
+    }
+
+    this->arenas[best].in_use = true;
+    return this->arenas[best].p;
+}
+
+void flbwt::Workspace::release(void *arena)
+{
+    if (arena != NULL)
+        this->arenas[this->find(arena)].in_use = false;
+}
+
+void *flbwt::Workspace::carve(uint64_t bytes)
+{
+    bytes = (bytes + 7) / 8 * 8;
+
+    // the fullest arena with room --> pieces pack into as few arenas as possible
+    uint64_t best = this->arenas.size();
+
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+    {
+        Arena &a = this->arenas[i];
+
+        if (a.in_use || a.bytes / 8 * 8 - a.carved < bytes)
+            continue;
+
+        if (best == this->arenas.size() || a.bytes - a.carved < this->arenas[best].bytes - this->arenas[best].carved)
+            best = i;
+    }
+
+    if (best == this->arenas.size())
+        return NULL;
+
+    Arena &a = this->arenas[best];
+    a.carved += bytes;
+
+    return a.p + a.bytes / 8 * 8 - a.carved;
+}
+
+bool flbwt::Workspace::can_carve(uint64_t bytes)
+{
+    bytes = (bytes + 7) / 8 * 8;
+
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+    {
+        if (!this->arenas[i].in_use && this->arenas[i].bytes / 8 * 8 - this->arenas[i].carved >= bytes)
+            return true;
+    }
+
+    return false;
+}
+
+uint8_t *flbwt::Workspace::detach(void *arena, uint64_t bytes)
+{
+    uint64_t i = this->find(arena);
+    Arena a = this->arenas[i];
+
+    if (a.carved != 0)
+        throw std::invalid_argument("Workspace failed(): Arena with carved pieces can not be detached");
+
+    this->arenas.erase(this->arenas.begin() + i);
+    flbwt::mem_untrack(a.bytes - bytes);
+
+    return a.p;
+}
+
+uint64_t flbwt::Workspace::get_size()
+{
+    uint64_t size = 0;
+
+    for (uint64_t i = 0; i < this->arenas.size(); i++)
+        size += this->arenas[i].bytes;
+
+    return size;
+}
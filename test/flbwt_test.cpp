@@ -1,6 +1,32 @@
 #include <gtest/gtest.h>
+#include <cstring>
+#include <sys/stat.h>
 #include "flbwt.hpp"
 
+/**
+ * @brief Next value of a 64-bit linear congruential generator.
+ */
+static uint64_t next_random(uint64_t &x)
+{
+    x = x * 6364136223846793005 + 1442695040888963407;
+    return x;
+}
+
+/**
+ * @brief Random DNA string over "acgt" (terminated, release with free).
+ */
+static uint8_t *random_dna(uint64_t n, uint64_t seed)
+{
+    uint8_t *T = (uint8_t *)malloc(n + 1);
+    uint64_t x = seed;
+
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = "acgt"[(next_random(x) >> 40) % 4];
+    T[n] = '\0';
+
+    return T;
+}
+
 TEST(flbwt_test, extract_LMS_strings_1)
 {
     uint8_t *T = (uint8_t *)"mmississiippii$";
@@ -47,3 +73,403 @@ TEST(flbwt_test, bwt_string_1)
     delete[] result->BWT;
     free(result);
 }
+
+/**
+ * @brief Run bwt_file for the given string and return the content of the output file.
+ */
+static std::string bwt_file_output(const char *content, const flbwt::BWT_options &options)
+{
+    const char *input_filename = "flbwt_test_input.txt";
+    const char *output_filename = "flbwt_test_output.bwt";
+
+    FILE *fp = fopen(input_filename, "wb");
+    fwrite(content, 1, strlen(content), fp);
+    fclose(fp);
+
+    flbwt::bwt_file(input_filename, output_filename, options);
+
+    std::string output;
+    fp = fopen(output_filename, "rb");
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+        output.push_back((char)c);
+    fclose(fp);
+
+    remove(input_filename);
+    remove(output_filename);
+    return output;
+}
+
+TEST(flbwt_test, bwt_file_1)
+{
+    flbwt::BWT_options options;
+    options.mmap_input = true;
+    std::string output = bwt_file_output("mmississiippii$", options);
+    EXPECT_EQ(8U + 15U, output.size());
+    EXPECT_EQ(9, output[7]);
+    EXPECT_EQ("$iipsismmpissii", output.substr(8));
+}
+
+TEST(flbwt_test, bwt_file_2)
+{
+    flbwt::BWT_options options;
+    options.mmap_input = false;
+    options.mmap_output = false;
+    std::string mapped = bwt_file_output("abracadabraabracadabra", flbwt::BWT_options());
+    std::string read = bwt_file_output("abracadabraabracadabra", options);
+    EXPECT_EQ(read, mapped);
+}
+
+TEST(flbwt_test, bwt_file_3)
+{
+    // input length is a multiple of the page size --> T[n] is outside the file mapping
+    std::string content;
+    for (uint64_t i = 0; i < 4096; i++)
+        content.push_back("acgt"[(i * i + i / 3) % 4]);
+
+    flbwt::BWT_options options;
+    options.mmap_input = false;
+    options.mmap_output = false;
+    std::string mapped = bwt_file_output(content.c_str(), flbwt::BWT_options());
+    std::string read = bwt_file_output(content.c_str(), options);
+    EXPECT_EQ(8U + 4096U, mapped.size());
+    EXPECT_EQ(read, mapped);
+}
+
+TEST(flbwt_test, bwt_file_4)
+{
+    // sentinel gap is near the beginning and at the very end of the BWT
+    flbwt::BWT_options options;
+    options.mmap_output = false;
+    EXPECT_EQ(bwt_file_output("aaaaaaab", options), bwt_file_output("aaaaaaab", flbwt::BWT_options()));
+    EXPECT_EQ(bwt_file_output("baaaaaaa", options), bwt_file_output("baaaaaaa", flbwt::BWT_options()));
+}
+
+TEST(flbwt_test, extract_LMS_strings_3)
+{
+    // long enough input to be split into chunks for the threads
+    const uint64_t n = 20000;
+    uint8_t *T = (uint8_t *)malloc(n + 1);
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = "mississippi"[(i * 7 + i / 13) % 11];
+    T[n] = '\0';
+
+    flbwt::Container *serial = flbwt::extract_LMS_strings(T, n, 1);
+    flbwt::Container *parallel = flbwt::extract_LMS_strings(T, n, 4);
+    EXPECT_EQ(serial->num_of_substrings, parallel->num_of_substrings);
+    EXPECT_EQ(serial->num_of_unique_substrings, parallel->num_of_unique_substrings);
+    EXPECT_EQ(serial->head_string_end, parallel->head_string_end);
+    for (uint16_t c = 0; c < 256 + 2; c++)
+    {
+        EXPECT_EQ(serial->M[c], parallel->M[c]);
+        EXPECT_EQ(serial->C[c], parallel->C[c]);
+        EXPECT_EQ(serial->NL[c], parallel->NL[c]);
+    }
+    delete serial;
+    delete parallel;
+    free(T);
+}
+
+TEST(flbwt_test, create_shortened_string_1)
+{
+    // T1 built from the recorded occurrences equals T1 built by hashing T again
+    const uint64_t n = 20000;
+    uint8_t *T = (uint8_t *)malloc(n + 1);
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = "abracadabra"[(i * 5 + i / 17) % 11];
+    T[n] = '\0';
+
+    for (unsigned threads = 1; threads <= 4; threads += 3)
+    {
+        flbwt::Container *hashed = flbwt::extract_LMS_strings(T, n, threads, flbwt::HASH_WORD, false);
+        uint8_t **S1 = flbwt::sort_LMS_strings(T, hashed);
+        flbwt::PackedArray *T1_hashed = flbwt::create_shortened_string(T, n, hashed);
+
+        flbwt::Container *recorded = flbwt::extract_LMS_strings(T, n, threads, flbwt::HASH_WORD, true);
+        uint8_t **S2 = flbwt::sort_LMS_strings(T, recorded);
+        flbwt::PackedArray *T1_recorded = flbwt::create_shortened_string(NULL, n, recorded);
+
+        EXPECT_EQ(T1_hashed->get_length(), T1_recorded->get_length());
+        for (uint64_t i = 0; i < T1_hashed->get_length(); i++)
+            EXPECT_EQ(T1_hashed->get_value(i), T1_recorded->get_value(i));
+
+        flbwt::mem_free(S1);
+        flbwt::mem_free(S2);
+        delete T1_hashed;
+        delete T1_recorded;
+        delete hashed;
+        delete recorded;
+    }
+    free(T);
+}
+
+TEST(flbwt_test, sort_LMS_strings_1)
+{
+    // enough unique substrings for the parallel sort
+    const uint64_t n = 200000;
+    uint8_t *T = (uint8_t *)malloc(n + 1);
+    uint64_t x = 12345;
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = 'a' + (next_random(x) >> 33) % 26;
+    T[n] = '\0';
+
+    flbwt::Container *serial = flbwt::extract_LMS_strings(T, n);
+    flbwt::Container *parallel = flbwt::extract_LMS_strings(T, n);
+    uint8_t **S1 = flbwt::sort_LMS_strings(T, serial, 1);
+    uint8_t **S2 = flbwt::sort_LMS_strings(T, parallel, 4);
+    EXPECT_LT(16384U, serial->num_of_unique_substrings);
+
+    for (uint64_t i = 1; i <= serial->num_of_unique_substrings; i++)
+        EXPECT_EQ(S1[i] - serial->hashtable->buf, S2[i] - parallel->hashtable->buf);
+
+    flbwt::mem_free(S1);
+    flbwt::mem_free(S2);
+    delete serial;
+    delete parallel;
+    free(T);
+}
+
+TEST(flbwt_test, sa_layout_1)
+{
+    // every SA storage must produce the same BWT as the narrowest one
+    std::string content;
+    for (uint64_t i = 0; i < 30000; i++)
+        content.push_back("acgt"[(i * i * 7 + i / 5) % 4]);
+
+    flbwt::BWT_options options;
+    options.mmap_output = false;
+    std::string expected = bwt_file_output(content.c_str(), options);
+
+    for (int layout = 0; layout <= 1; layout++)
+    {
+        options.sa_layout = layout ? flbwt::SA_LAYOUT_PACKED : flbwt::SA_LAYOUT_SPLIT;
+
+        for (uint8_t bits = 32; bits <= 64; bits += 8)
+        {
+            options.min_sa_bits = bits;
+            EXPECT_EQ(expected, bwt_file_output(content.c_str(), options)) << "layout " << layout << " bits " << (int)bits;
+        }
+    }
+}
+
+TEST(flbwt_test, bwt_string_threads_1)
+{
+    // large enough for parallel extraction, sorting and induce batches
+    const uint64_t n = 400000;
+    uint8_t *T = random_dna(n, 777);
+
+    flbwt::BWT_options options;
+    flbwt::BWT_result *serial = flbwt::bwt_string(T, n, false, options);
+    options.threads = 4;
+    flbwt::BWT_result *parallel = flbwt::bwt_string(T, n, false, options);
+
+    // BWT[last] is the unused sentinel slot
+    ASSERT_EQ(serial->last, parallel->last);
+    EXPECT_EQ(0, memcmp(serial->BWT, parallel->BWT, serial->last));
+    EXPECT_EQ(0, memcmp(serial->BWT + serial->last + 1, parallel->BWT + serial->last + 1, n - serial->last));
+
+    delete[] serial->BWT;
+    free(serial);
+    delete[] parallel->BWT;
+    free(parallel);
+    free(T);
+}
+
+TEST(flbwt_test, scratch_dir_1)
+{
+    // the induce queues spill to the scratch file with a zero RAM budget
+    const uint64_t n = 2000000;
+    uint8_t *T = random_dna(n, 4242);
+
+    flbwt::BWT_options options;
+    flbwt::BWT_result *memory = flbwt::bwt_string(T, n, false, options);
+
+    flbwt::Stats stats;
+    options.scratch_dir = "/tmp";
+    options.stats = &stats;
+    flbwt::BWT_result *external = flbwt::bwt_string(T, n, false, options);
+
+    EXPECT_LT(0U, stats.spilled_blocks);
+
+    // the SA of T1 is not spilled --> a budget it doesn't fit in fails right away
+    options.ram_budget = 1024;
+    EXPECT_THROW(flbwt::bwt_string(T, n, false, options), std::runtime_error);
+
+    ASSERT_EQ(memory->last, external->last);
+    EXPECT_EQ(0, memcmp(memory->BWT, external->BWT, memory->last));
+    EXPECT_EQ(0, memcmp(memory->BWT + memory->last + 1, external->BWT + memory->last + 1, n - memory->last));
+
+    delete[] memory->BWT;
+    free(memory);
+    delete[] external->BWT;
+    free(external);
+    free(T);
+}
+
+TEST(flbwt_test, plan_memory_1)
+{
+    const uint64_t n = 300000;
+    uint8_t *T = random_dna(n, 99);
+
+    flbwt::Container *container = flbwt::extract_LMS_strings(T, n, 1, flbwt::HASH_WORD, true);
+    uint8_t **S = flbwt::sort_LMS_strings(T, container);
+
+    flbwt::BWT_options options;
+    options.threads = 4;
+
+    // no limit --> in memory with the requested threads
+    flbwt::Memory_plan plan = flbwt::plan_memory(container, 0, n + 1, false, false, 32, options);
+    EXPECT_FALSE(plan.keep_T);
+    EXPECT_FALSE(plan.spill_queues);
+    EXPECT_EQ((uint64_t)QSIZ, plan.queue_block_size);
+    EXPECT_EQ(4U, plan.threads);
+    EXPECT_EQ(plan.phase_bytes[plan.peak_phase], plan.peak_bytes);
+
+    // a limit just under the estimate --> some change lowers it
+    flbwt::Memory_plan lower = flbwt::plan_memory(container, plan.peak_bytes - 1, n + 1, false, false, 32, options);
+    EXPECT_GT(plan.peak_bytes, lower.peak_bytes);
+
+    // an impossible limit --> the estimate stays over it, threads are dropped
+    flbwt::Memory_plan impossible = flbwt::plan_memory(container, 1, n + 1, false, false, 32, options);
+    EXPECT_LT(1U, impossible.peak_bytes);
+    EXPECT_EQ(1U, impossible.threads);
+
+    flbwt::mem_free(S);
+    delete container;
+    free(T);
+}
+
+TEST(flbwt_test, max_memory_1)
+{
+    const uint64_t n = 1000000;
+    uint8_t *T = random_dna(n, 2024);
+
+    flbwt::Stats stats;
+    flbwt::BWT_options options;
+    options.stats = &stats;
+    flbwt::BWT_result *expected = flbwt::bwt_string(T, n, false, options);
+    uint64_t peak = stats.get_peak_memory() + n + 1;
+
+    // the limit can't be met --> fails before T1 is built, naming the part that can't be spilled
+    options.max_memory = n;
+    try
+    {
+        flbwt::bwt_string(T, n, false, options);
+        ADD_FAILURE() << "max_memory " << n << " was met";
+    }
+    catch (const std::runtime_error &e)
+    {
+        EXPECT_NE(std::string::npos, std::string(e.what()).find("suffix array of T1"));
+    }
+
+    // tighter limits spill the induce queues, results stay the same
+    bool spilled = false;
+
+    for (uint64_t percent = 100; percent >= 70; percent -= 5)
+    {
+        flbwt::Stats run;
+        options.stats = &run;
+        options.max_memory = peak * percent / 100;
+        flbwt::BWT_result *result = NULL;
+
+        try
+        {
+            result = flbwt::bwt_string(T, n, false, options);
+        }
+        catch (const std::runtime_error &)
+        {
+            continue;
+        }
+
+        EXPECT_GE(options.max_memory, run.get_peak_memory() + n + 1) << percent << "%";
+        spilled |= (run.spilled_blocks > 0);
+
+        ASSERT_EQ(expected->last, result->last);
+        EXPECT_EQ(0, memcmp(expected->BWT, result->BWT, expected->last));
+        EXPECT_EQ(0, memcmp(expected->BWT + expected->last + 1, result->BWT + expected->last + 1, n - expected->last));
+
+        delete[] result->BWT;
+        free(result);
+    }
+
+    EXPECT_TRUE(spilled);
+
+    delete[] expected->BWT;
+    free(expected);
+    free(T);
+}
+
+TEST(flbwt_test, max_memory_2)
+{
+    const char *input_filename = "flbwt_test_input.txt";
+    const char *output_filename = "flbwt_test_output.bwt";
+    const uint64_t n = 100000;
+
+    uint8_t *T = random_dna(n, 99);
+    FILE *fp = fopen(input_filename, "wb");
+    fwrite(T, 1, n, fp);
+    fclose(fp);
+    free(T);
+
+    // the limit can't be met --> no output file is created, with or without mapping it
+    for (int mapped = 0; mapped < 2; mapped++)
+    {
+        flbwt::BWT_options options;
+        options.mmap_output = mapped;
+        options.max_memory = n;
+        struct stat st;
+
+        remove(output_filename);
+        EXPECT_THROW(flbwt::bwt_file(input_filename, output_filename, options), std::runtime_error);
+        EXPECT_NE(0, stat(output_filename, &st));
+
+        // an existing output file is not truncated
+        fp = fopen(output_filename, "wb");
+        fputs("previous", fp);
+        fclose(fp);
+
+        EXPECT_THROW(flbwt::bwt_file(input_filename, output_filename, options), std::runtime_error);
+        ASSERT_EQ(0, stat(output_filename, &st));
+        EXPECT_EQ(8, st.st_size);
+    }
+
+    remove(input_filename);
+    remove(output_filename);
+}
+
+TEST(flbwt_test, random_bytes_1)
+{
+    // nearly every S* substring is unique --> the hashtable grows with rehash
+    const uint64_t n = 1 << 20;
+    uint8_t *T = (uint8_t *)malloc(n + 1);
+    uint64_t x = 4242;
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = next_random(x) >> 56;
+    T[n] = '\0';
+
+    flbwt::Stats stats;
+    flbwt::BWT_options options;
+    options.stats = &stats;
+    flbwt::BWT_result *serial = flbwt::bwt_string(T, n, false, options);
+
+    // the rehashed buckets are packed without a fixed reserve per bucket
+    EXPECT_GT(stats.num_of_unique_substrings, n / 4);
+    EXPECT_LT(stats.get_peak_memory(flbwt::PHASE_EXTRACT), (int64_t)(16 * n));
+    EXPECT_LT(stats.get_peak_memory(), (int64_t)(32 * n));
+
+    flbwt::Stats parallel_stats;
+    options.stats = &parallel_stats;
+    options.threads = 4;
+    flbwt::BWT_result *parallel = flbwt::bwt_string(T, n, false, options);
+    EXPECT_LT(parallel_stats.get_peak_memory(flbwt::PHASE_EXTRACT), (int64_t)(16 * n));
+
+    ASSERT_EQ(serial->last, parallel->last);
+    EXPECT_EQ(0, memcmp(serial->BWT, parallel->BWT, serial->last));
+    EXPECT_EQ(0, memcmp(serial->BWT + serial->last + 1, parallel->BWT + serial->last + 1, n - serial->last));
+
+    delete[] serial->BWT;
+    free(serial);
+    delete[] parallel->BWT;
+    free(parallel);
+    free(T);
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "hashtable.hpp"
+#include "memory.hpp"
 
 TEST(hashtable_test, construct_hashtable_1)
 {
@@ -31,7 +35,7 @@ TEST(hashtable_test, get_length_1)
 {
     const uint64_t n = 16;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(100 * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(100 * sizeof(uint8_t));
     hashtable->bufsize = 100;
     hashtable->buf[0] = 3;
     hashtable->buf[1] = 123;                                        // 01111011
@@ -45,7 +49,7 @@ TEST(hashtable_test, get_length_2)
 {
     const uint64_t n = 16;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(100 * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(100 * sizeof(uint8_t));
     hashtable->bufsize = 100;
     hashtable->buf[0] = 8;
     hashtable->buf[1] = 0xff;
@@ -64,7 +68,7 @@ TEST(hashtable_test, set_length_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(100 * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(100 * sizeof(uint8_t));
     hashtable->bufsize = 100;
     hashtable->set_length(&hashtable->buf[0], 0xfeffef);
     EXPECT_EQ(3U, hashtable->buf[0]);
@@ -78,7 +82,7 @@ TEST(hashtable_test, set_length_2)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(100 * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(100 * sizeof(uint8_t));
     hashtable->bufsize = 100;
     hashtable->set_length(&hashtable->buf[0], 0xfe0000);
     EXPECT_EQ(3U, hashtable->buf[0]);
@@ -92,7 +96,7 @@ TEST(hashtable_test, string_info_length_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(100 * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(100 * sizeof(uint8_t));
     hashtable->bufsize = 100;
     hashtable->set_length(&hashtable->buf[0], 0xff);
     uint64_t chars = hashtable->string_info_length(&hashtable->buf[0], 0xff);
@@ -104,7 +108,7 @@ TEST(hashtable_test, string_info_length_2)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xffff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xffff * sizeof(uint8_t));
     hashtable->bufsize = 0xffff;
     hashtable->set_length(&hashtable->buf[0], 0xffee);
     uint64_t chars = hashtable->string_info_length(&hashtable->buf[0], 0xffee);
@@ -116,7 +120,7 @@ TEST(hashtable_test, get_pointer_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->buf[0] = 1;
     hashtable->buf[1] = 2;  // length 2 --> pointer
@@ -136,7 +140,7 @@ TEST(hashtable_test, set_pointer_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->set_pointer(&hashtable->buf[0], 72623859790382856U);
     EXPECT_EQ(1U, hashtable->buf[0]); // x bytes character
@@ -184,7 +188,7 @@ TEST(hashtable_test, get_lenlen)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->buf[0] = 3;
     EXPECT_EQ(3U, hashtable->get_lenlen(&hashtable->buf[0])); // x bytes character
@@ -203,7 +207,7 @@ TEST(hashtable_test, get_name_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->NAME_BYTES = 2;
     hashtable->buf[0] = 1;
@@ -218,7 +222,7 @@ TEST(hashtable_test, set_name_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->buf[0] = 1;  // x bytes length
     hashtable->buf[1] = 1;  // actual length
@@ -232,7 +236,7 @@ TEST(hashtable_test, get_first_character_pointer_1)
 {
     const uint64_t n = 1000;
     flbwt::HashTable *hashtable = new flbwt::HashTable(100, n);
-    hashtable->buf = (uint8_t*)malloc(0xff * sizeof(uint8_t));
+    hashtable->buf = (uint8_t*)flbwt::mem_alloc(0xff * sizeof(uint8_t));
     hashtable->bufsize = 0xff;
     hashtable->buf[0] = 1;  // x bytes length
     hashtable->buf[1] = 1;  // actual length
@@ -264,4 +268,135 @@ TEST(hashtable_test, find_name_1)
     EXPECT_EQ(2U, hashtable->find_name(T, 7, 8));
     EXPECT_ANY_THROW(hashtable->find_name(T, 3, 3));
     delete hashtable;
-}*/
\ No newline at end of file
+}*/
+
+TEST(hashtable_test, merge_shards_1)
+{
+    uint8_t *T = (uint8_t *)"mmississiippii$";
+    const uint64_t n = 15;
+    flbwt::HashTable *hashtable = new flbwt::HashTable(100, n, 3);
+    EXPECT_EQ(1U, hashtable->insert_string(4, &T[2]));
+    EXPECT_EQ(0U, hashtable->insert_string(4, &T[5]));
+    EXPECT_EQ(1U, hashtable->insert_string(7, &T[8]));
+    EXPECT_EQ(1U, hashtable->insert_string(3, &T[12]));
+    hashtable->merge_shards();
+    EXPECT_EQ(1U, hashtable->SHARDS);
+    EXPECT_EQ(NULL, hashtable->shards);
+    EXPECT_EQ(0U, hashtable->insert_string(7, &T[8]));
+    hashtable->set_name(&hashtable->buf[hashtable->head[hashtable->hash_function(4, &T[2])]], 1);
+    hashtable->set_name(&hashtable->buf[hashtable->head[hashtable->hash_function(7, &T[8])]], 2);
+    EXPECT_EQ(1U, hashtable->find_name(4, &T[5]));
+    EXPECT_EQ(2U, hashtable->find_name(7, &T[8]));
+    EXPECT_ANY_THROW(hashtable->find_name(3, &T[3]));
+    delete hashtable;
+}
+
+TEST(hashtable_test, merge_shards_2)
+{
+    // few buckets and many substrings --> buckets consist of several element blocks
+    const uint64_t n = 4000;
+    uint8_t *T = (uint8_t *)malloc(n);
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = 'a' + (i * i + i / 7) % 26;
+
+    flbwt::HashTable *hashtable = new flbwt::HashTable(5, n, 2);
+    hashtable->MAX_LOAD_FACTOR = 0;
+    uint64_t inserted = 0;
+    for (uint64_t i = 0; i + 20 < n; i += 10)
+        inserted += hashtable->insert_string(20, &T[i]);
+    hashtable->merge_shards();
+
+    for (uint64_t i = 0; i + 20 < n; i += 10)
+        EXPECT_EQ(0U, hashtable->insert_string(20, &T[i]));
+    EXPECT_EQ(1U, hashtable->insert_string(21, &T[0]));
+    EXPECT_LT(inserted * 20, hashtable->bufsize);
+    delete hashtable;
+    free(T);
+}
+
+TEST(hashtable_test, merge_shards_3)
+{
+    const uint64_t n = 40000;
+    uint8_t *T = (uint8_t *)malloc(n);
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = 'a' + (i * i + i / 7) % 26;
+
+    // shards grow the table while inserting from several threads
+    flbwt::HashTable *hashtable = new flbwt::HashTable(5, n, 4);
+    std::atomic<uint64_t> inserted(0);
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; t++)
+        threads.emplace_back([&, t]() {
+            for (uint64_t i = t * 10; i + 20 < n; i += 40)
+                inserted += hashtable->insert_string(20, &T[i]);
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    EXPECT_LT(5U, hashtable->HTSIZE);
+
+    hashtable->merge_shards();
+    EXPECT_EQ(inserted, hashtable->num_of_strings);
+    EXPECT_LE(hashtable->num_of_strings, 4 * hashtable->HTSIZE);
+    for (uint64_t i = 0; i + 20 < n; i += 10)
+        EXPECT_EQ(0U, hashtable->insert_string(20, &T[i]));
+    delete hashtable;
+    free(T);
+}
+
+TEST(hashtable_test, rehash_1)
+{
+    const uint64_t n = 4000;
+    uint8_t *T = (uint8_t *)malloc(n);
+    for (uint64_t i = 0; i < n; i++)
+        T[i] = 'a' + (i * i + i / 7) % 26;
+
+    // table grows automatically when there are more than 4 substrings per bucket
+    flbwt::HashTable *hashtable = new flbwt::HashTable(3, n);
+    uint64_t inserted = 0;
+    for (uint64_t i = 0; i + 20 < n; i += 10)
+        inserted += hashtable->insert_string(20, &T[i]);
+    EXPECT_EQ(inserted, hashtable->num_of_strings);
+    EXPECT_LE(hashtable->num_of_strings, 4 * hashtable->HTSIZE);
+
+    // names are kept when the table is rehashed manually
+    hashtable->rehash(100003);
+    uint64_t h = hashtable->hash_function(20, &T[0]);
+    hashtable->set_name(&hashtable->buf[hashtable->head[h]], 77);
+    hashtable->rehash(1001);
+    EXPECT_EQ(1001U, hashtable->HTSIZE);
+    EXPECT_EQ(77U, hashtable->find_name(20, &T[0]));
+    for (uint64_t i = 0; i + 20 < n; i += 10)
+        EXPECT_EQ(0U, hashtable->insert_string(20, &T[i]));
+    delete hashtable;
+    free(T);
+}
+
+TEST(hashtable_test, word_hash_function_1)
+{
+    uint8_t *T = (uint8_t *)"mmississiippiimmississiippii$";
+    const uint64_t n = 29;
+    flbwt::HashTable *hashtable = new flbwt::HashTable(100, n, 1, flbwt::HASH_WORD);
+    const uint64_t h1 = hashtable->hash_function(4, &T[2]);
+    const uint64_t h2 = hashtable->hash_function(4, &T[5]);
+    const uint64_t h3 = hashtable->hash_function(13, &T[1]);
+    const uint64_t h4 = hashtable->hash_function(13, &T[15]);
+    EXPECT_EQ(h1, h2);
+    EXPECT_EQ(h3, h4);
+    EXPECT_LT(h1, 100U);
+    EXPECT_LT(h3, 100U);
+    EXPECT_EQ(h3, hashtable->word_hash_function(13, &T[1]));
+    delete hashtable;
+}
+
+TEST(hashtable_test, word_hash_function_2)
+{
+    uint8_t *T = (uint8_t *)"mmississiippii$";
+    const uint64_t n = 15;
+    flbwt::HashTable *hashtable = new flbwt::HashTable(100, n, 1, flbwt::HASH_WORD);
+    EXPECT_EQ(1U, hashtable->insert_string(4, &T[2]));
+    EXPECT_EQ(0U, hashtable->insert_string(4, &T[5]));
+    EXPECT_EQ(1U, hashtable->insert_string(7, &T[8]));
+    hashtable->set_name(&hashtable->buf[hashtable->head[hashtable->hash_function(7, &T[8])]], 2);
+    EXPECT_EQ(2U, hashtable->find_name(7, &T[8]));
+    delete hashtable;
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "memory.hpp"
+
+TEST(memory_test, alloc_free_1)
+{
+    int64_t before = flbwt::mem_current();
+
+    uint8_t *p = (uint8_t *)flbwt::mem_alloc(1000);
+    EXPECT_LE(before + 1000, flbwt::mem_current());
+
+    p = (uint8_t *)flbwt::mem_realloc(p, 100000);
+    EXPECT_LE(before + 100000, flbwt::mem_current());
+
+    flbwt::mem_free(p);
+    EXPECT_EQ(before, flbwt::mem_current());
+
+    flbwt::mem_free(NULL);
+    EXPECT_EQ(before, flbwt::mem_current());
+}
+
+TEST(memory_test, peak_1)
+{
+    flbwt::mem_reset_peak();
+    int64_t before = flbwt::mem_current();
+    EXPECT_EQ(before, flbwt::mem_peak());
+
+    uint64_t *A = flbwt::mem_new_array<uint64_t>(10000);
+    flbwt::mem_free(A);
+    flbwt::mem_track(500);
+    flbwt::mem_untrack(500);
+
+    EXPECT_EQ(before, flbwt::mem_current());
+    EXPECT_LE(before + 80000, flbwt::mem_peak());
+
+    flbwt::mem_reset_peak();
+    EXPECT_EQ(before, flbwt::mem_peak());
+}
@@ -289,4 +289,86 @@ TEST(packed_array_test, extra_test_1)
     pa->set_value(29098, 2);
     EXPECT_EQ(2, pa->get_value(29098));
     delete pa;
-}
\ No newline at end of file
+}
+
+TEST(packed_array_test, pack_unpack_1)
+{
+    // bulk access must match single value access for every width and alignment
+    for (uint8_t bits = 1; bits <= 64; bits++)
+    {
+        uint64_t mask = BIT_MASK(uint64_t, bits);
+        flbwt::PackedArray *pa = new flbwt::PackedArray(300, bits);
+        uint64_t in[300];
+        uint64_t out[300];
+
+        for (uint64_t i = 0; i < 300; i++)
+        {
+            pa->set_value(i, (i * 0x9e3779b97f4a7c15ULL) & mask);
+            in[i] = (i * 0xc2b2ae3d27d4eb4fULL + 7) & mask;
+        }
+
+        pa->unpack(3, 290, out);
+        for (uint64_t i = 0; i < 290; i++)
+            ASSERT_EQ(((i + 3) * 0x9e3779b97f4a7c15ULL) & mask, out[i]) << (int)bits;
+
+        pa->pack(5, 100, in);
+        for (uint64_t i = 0; i < 300; i++)
+        {
+            uint64_t expected = (i >= 5 && i < 105) ? in[i - 5] : (i * 0x9e3779b97f4a7c15ULL) & mask;
+            ASSERT_EQ(expected, pa->get_value(i)) << (int)bits << " " << i;
+        }
+
+        delete pa;
+    }
+}
+
+TEST(packed_array_test, reader_writer_1)
+{
+    flbwt::PackedArray *pa = new flbwt::PackedArray(1000, 13);
+    for (uint64_t i = 0; i < 1000; i++)
+        pa->set_value(i, 8191);
+
+    flbwt::PackedArrayWriter writer(pa->get_raw_arr_pointer(), 13, 17);
+    for (uint64_t i = 0; i < 500; i++)
+        writer.put(i);
+    writer.flush();
+
+    flbwt::PackedArrayReader reader(pa->get_raw_arr_pointer(), 13, 0);
+    for (uint64_t i = 0; i < 1000; i++)
+        EXPECT_EQ((i >= 17 && i < 517) ? i - 17 : 8191U, reader.next());
+
+    delete pa;
+}
+
+template <unsigned Bits>
+static void check_fixed_packed_array()
+{
+    uint64_t mask = BIT_MASK(uint64_t, Bits);
+    uint64_t *arr = new uint64_t[flbwt::PackedArray::words_required(500, Bits)]();
+
+    for (uint64_t i = 0; i < 500; i++)
+        flbwt::FixedPackedArray<Bits>::set_value(arr, i, (i * 0x9e3779b97f4a7c15ULL) & mask);
+
+    flbwt::PackedArrayReader reader(arr, Bits, 0);
+    for (uint64_t i = 0; i < 500; i++)
+    {
+        ASSERT_EQ((i * 0x9e3779b97f4a7c15ULL) & mask, reader.next()) << Bits;
+        ASSERT_EQ((i * 0x9e3779b97f4a7c15ULL) & mask, flbwt::FixedPackedArray<Bits>::get_value(arr, i)) << Bits;
+    }
+
+    delete[] arr;
+}
+
+TEST(packed_array_test, fixed_packed_array_1)
+{
+    check_fixed_packed_array<1>();
+    check_fixed_packed_array<7>();
+    check_fixed_packed_array<8>();
+    check_fixed_packed_array<13>();
+    check_fixed_packed_array<16>();
+    check_fixed_packed_array<31>();
+    check_fixed_packed_array<32>();
+    check_fixed_packed_array<33>();
+    check_fixed_packed_array<63>();
+    check_fixed_packed_array<64>();
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include "queue.hpp"
+
+TEST(queue_test, queue_1)
+{
+    flbwt::Queue *queue = new flbwt::Queue(20);
+    EXPECT_TRUE(queue->is_empty());
+
+    for (uint64_t i = 0; i < 5000; i++)
+        queue->enqueue(i * 97 % 1000003);
+
+    queue->enqueue_l(7);
+    EXPECT_EQ(5001U, queue->size());
+    EXPECT_EQ(7, queue->dequeue());
+
+    for (uint64_t i = 0; i < 5000; i++)
+        EXPECT_EQ((int64_t)(i * 97 % 1000003), queue->dequeue());
+
+    EXPECT_TRUE(queue->is_empty());
+    delete queue;
+}
+
+TEST(queue_test, bulk_1)
+{
+    flbwt::QueuePool pool(13, 100);
+    flbwt::Queue *a = new flbwt::Queue(&pool);
+    flbwt::Queue *b = new flbwt::Queue(&pool);
+    std::deque<uint64_t> expected;
+    uint64_t buf[333];
+
+    for (uint64_t round = 0; round < 50; round++)
+    {
+        for (uint64_t i = 0; i < 333; i++)
+            buf[i] = (round * 333 + i) & 0x1fff;
+
+        a->enqueue(buf, 100 + round * 3);
+        b->enqueue(buf, 7);
+        expected.insert(expected.end(), buf, buf + 100 + round * 3);
+
+        uint64_t k = a->dequeue(buf, 90 + round);
+        ASSERT_EQ(90 + round, k);
+        for (uint64_t i = 0; i < k; i++)
+        {
+            EXPECT_EQ(expected.front(), buf[i]);
+            expected.pop_front();
+        }
+    }
+
+    EXPECT_EQ(expected.size(), a->size());
+    while (!a->is_empty())
+    {
+        uint64_t k = a->dequeue(buf, 333);
+        for (uint64_t i = 0; i < k; i++)
+        {
+            EXPECT_EQ(expected.front(), buf[i]);
+            expected.pop_front();
+        }
+    }
+    EXPECT_TRUE(expected.empty());
+    EXPECT_EQ(350U, b->size());
+
+    // blocks released by the first queue are recycled
+    uint64_t blocks = pool.get_num_of_blocks();
+    for (uint64_t i = 0; i < 2000; i++)
+        a->enqueue(i & 0x1fff);
+    EXPECT_EQ(blocks, pool.get_num_of_blocks());
+
+    delete a;
+    delete b;
+}
+
+TEST(queue_test, spill_1)
+{
+    // zero budget --> every full block after the first slab goes to the scratch file
+    flbwt::QueuePool pool(17, 50);
+    pool.set_scratch("/tmp", 0);
+    flbwt::Queue *a = new flbwt::Queue(&pool);
+    flbwt::Queue *b = new flbwt::Queue(&pool);
+    std::deque<uint64_t> expected;
+
+    for (uint64_t i = 0; i < 40000; i++)
+    {
+        a->enqueue(i * 31 & 0x1ffff);
+        expected.push_back(i * 31 & 0x1ffff);
+        b->enqueue(i & 0x1ffff);
+    }
+
+    EXPECT_EQ(64U, pool.get_num_of_blocks());
+    EXPECT_LT(0U, pool.get_num_of_spilled_blocks());
+
+    for (uint64_t i = 0; i < 120; i++)
+    {
+        a->enqueue_l(i);
+        expected.push_front(i);
+    }
+
+    for (uint64_t i = 0; i < 20000; i++)
+    {
+        EXPECT_EQ((int64_t)expected.front(), a->dequeue());
+        expected.pop_front();
+    }
+
+    // spilled positions are reused
+    for (uint64_t i = 0; i < 10000; i++)
+    {
+        a->enqueue(i);
+        expected.push_back(i);
+    }
+
+    EXPECT_EQ(expected.size(), a->size());
+    while (!a->is_empty())
+    {
+        EXPECT_EQ((int64_t)expected.front(), a->dequeue());
+        expected.pop_front();
+    }
+
+    for (uint64_t i = 0; i < 40000; i++)
+        EXPECT_EQ((int64_t)i, b->dequeue());
+
+    delete a;
+    delete b;
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "packed_array.hpp"
+#include "sais.hpp"
+
+/**
+ * @brief Build packed string (value i stored at index i + 1) ending with the unique minimum 0.
+ */
+static flbwt::PackedArray *random_packed_string(uint64_t n, uint64_t k, std::vector<uint64_t> &values)
+{
+    std::mt19937_64 rng(n * 31 + k);
+    uint8_t bits = 5;
+    flbwt::PackedArray *T = new flbwt::PackedArray(n + 1, bits);
+    values.assign(n, 0);
+
+    for (uint64_t i = 0; i + 1 < n; i++)
+        values[i] = 1 + rng() % (k - 1);
+
+    for (uint64_t i = 0; i < n; i++)
+        T->set_value(i + 1, values[i]);
+
+    return T;
+}
+
+static std::vector<int64_t> naive_suffix_array(const std::vector<uint64_t> &values)
+{
+    std::vector<int64_t> SA(values.size());
+    for (uint64_t i = 0; i < SA.size(); i++)
+        SA[i] = i;
+
+    std::sort(SA.begin(), SA.end(), [&](int64_t a, int64_t b) {
+        return std::lexicographical_compare(values.begin() + a, values.end(), values.begin() + b, values.end());
+    });
+
+    return SA;
+}
+
+template <class Storage>
+static void check_storage(flbwt::PackedArray *T, const std::vector<int64_t> &expected, uint64_t k,
+                          unsigned threads = 1)
+{
+    uint64_t n = expected.size();
+    Storage SA = Storage::allocate(n);
+    flbwt::sais(T->get_raw_arr_pointer(), T->get_integer_bits(), SA, 0, n, k, threads);
+
+    for (uint64_t i = 0; i < n; i++)
+        EXPECT_EQ(expected[i], SA.get(i)) << "storage " << (int)Storage::BITS << " index " << i;
+
+    SA.release();
+}
+
+TEST(sais_test, storages_1)
+{
+    std::vector<uint64_t> values;
+    flbwt::PackedArray *T = random_packed_string(5000, 3, values);
+    std::vector<int64_t> expected = naive_suffix_array(values);
+
+    check_storage<flbwt::SAStorage32>(T, expected, 3);
+    check_storage<flbwt::SAStorage40>(T, expected, 3);
+    check_storage<flbwt::SAStorage48>(T, expected, 3);
+    check_storage<flbwt::SAStorage56>(T, expected, 3);
+    check_storage<flbwt::SAStorage64>(T, expected, 3);
+
+    delete T;
+}
+
+TEST(sais_test, storages_2)
+{
+    std::vector<uint64_t> values;
+    flbwt::PackedArray *T = random_packed_string(20000, 20, values);
+    std::vector<int64_t> expected = naive_suffix_array(values);
+
+    check_storage<flbwt::SAStorage32>(T, expected, 20);
+    check_storage<flbwt::SAStorage40>(T, expected, 20);
+    check_storage<flbwt::SAStorage48>(T, expected, 20);
+    check_storage<flbwt::SAStorage56>(T, expected, 20);
+    check_storage<flbwt::SAStorage64>(T, expected, 20);
+    check_storage<flbwt::SAStoragePacked40>(T, expected, 20);
+    check_storage<flbwt::SAStoragePacked48>(T, expected, 20);
+    check_storage<flbwt::SAStoragePacked56>(T, expected, 20);
+
+    delete T;
+}
+
+TEST(sais_test, threads_1)
+{
+    std::vector<uint64_t> values;
+    flbwt::PackedArray *T = random_packed_string(300000, 4, values);
+    std::vector<int64_t> expected = naive_suffix_array(values);
+
+    check_storage<flbwt::SAStorage32>(T, expected, 4, 4);
+    check_storage<flbwt::SAStorage40>(T, expected, 4, 4);
+    check_storage<flbwt::SAStoragePacked48>(T, expected, 4, 4);
+
+    delete T;
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
+#include "flbwt.hpp"
+#include "stats.hpp"
+
+TEST(stats_test, phases_1)
+{
+    flbwt::Stats stats;
+    EXPECT_EQ(0, stats.get_wall_time(flbwt::PHASE_SAIS));
+    EXPECT_STREQ("extract", flbwt::Stats::get_phase_name(flbwt::PHASE_EXTRACT));
+    EXPECT_STREQ("write", flbwt::Stats::get_phase_name(flbwt::PHASE_WRITE));
+
+    stats.start(flbwt::PHASE_SAIS);
+    stats.stop(flbwt::PHASE_SAIS);
+    double first = stats.get_wall_time(flbwt::PHASE_SAIS);
+    stats.start(flbwt::PHASE_SAIS);
+    stats.stop(flbwt::PHASE_SAIS);
+    EXPECT_LE(first, stats.get_wall_time(flbwt::PHASE_SAIS));
+    EXPECT_LE(0, stats.get_cpu_time(flbwt::PHASE_SAIS));
+
+    stats.reset();
+    EXPECT_EQ(0, stats.get_wall_time(flbwt::PHASE_SAIS));
+}
+
+TEST(stats_test, bwt_string_1)
+{
+    uint8_t *T = (uint8_t *)"mmississiippii$";
+    const uint64_t n = 15;
+    flbwt::Stats stats;
+    flbwt::BWT_options options;
+    options.stats = &stats;
+
+    flbwt::BWT_result *result = flbwt::bwt_string(T, n, false, options);
+    EXPECT_EQ(9U, result->last);
+    delete[] result->BWT;
+    free(result);
+
+    flbwt::Container *container = flbwt::extract_LMS_strings(T, n);
+    EXPECT_EQ(container->num_of_substrings, stats.num_of_substrings);
+    EXPECT_EQ(container->num_of_unique_substrings, stats.num_of_unique_substrings);
+    delete container;
+
+    EXPECT_EQ(32U, stats.sa_bits);
+    EXPECT_LT(0U, stats.queue_blocks);
+    EXPECT_EQ(0, stats.get_wall_time(flbwt::PHASE_WRITE));
+
+    std::ostringstream out;
+    stats.print(out);
+    EXPECT_NE(std::string::npos, out.str().find("induce: "));
+}
+
+TEST(stats_test, peak_memory_1)
+{
+    std::vector<uint8_t> input(100000);
+    for (uint64_t i = 0; i + 1 < input.size(); i++)
+        input[i] = 'a' + (i * 7919 + i / 13) % 5;
+    input.back() = '\0';
+
+    flbwt::Stats stats;
+    flbwt::BWT_options options;
+    options.stats = &stats;
+
+    flbwt::BWT_result *result = flbwt::bwt_string(input.data(), input.size() - 1, false, options);
+
+    // the BWT buffer alone is live during the induce phase
+    EXPECT_LE((int64_t)input.size(), stats.get_peak_memory(flbwt::PHASE_INDUCE));
+    EXPECT_LT(0, stats.get_peak_memory(flbwt::PHASE_EXTRACT));
+    EXPECT_LT(0, stats.get_peak_memory(flbwt::PHASE_SAIS));
+    EXPECT_LE(stats.get_peak_memory(flbwt::PHASE_SAIS), stats.get_peak_memory());
+    EXPECT_LE(stats.get_peak_memory(flbwt::PHASE_INDUCE), stats.get_peak_memory());
+
+    delete[] result->BWT;
+    free(result);
+}
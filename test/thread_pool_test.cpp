@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+#include "thread_pool.hpp"
+
+TEST(thread_pool_test, run_1)
+{
+    flbwt::ThreadPool pool(4);
+    EXPECT_EQ(4U, pool.size());
+
+    std::vector<int> hits(4, 0);
+    for (int round = 0; round < 100; round++)
+        pool.run([&](unsigned t) { hits[t]++; });
+
+    for (unsigned t = 0; t < 4; t++)
+        EXPECT_EQ(100, hits[t]);
+}
+
+TEST(thread_pool_test, parallel_for_1)
+{
+    flbwt::ThreadPool pool(3);
+    std::vector<uint64_t> values(1001, 0);
+    std::atomic<uint64_t> ranges(0);
+
+    pool.parallel_for(values.size(), [&](uint64_t begin, uint64_t end) {
+        ranges++;
+        for (uint64_t i = begin; i < end; i++)
+            values[i] += i;
+    });
+
+    EXPECT_EQ(3U, ranges.load());
+    for (uint64_t i = 0; i < values.size(); i++)
+        EXPECT_EQ(i, values[i]);
+
+    flbwt::ThreadPool single(1);
+    single.parallel_for(10, [&](uint64_t begin, uint64_t end) {
+        EXPECT_EQ(0U, begin);
+        EXPECT_EQ(10U, end);
+    });
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include "memory.hpp"
+#include "workspace.hpp"
+
+TEST(workspace_test, acquire_1)
+{
+    int64_t before = flbwt::mem_current();
+
+    {
+        flbwt::Workspace workspace;
+        void *a = workspace.acquire(1000);
+        void *b = workspace.acquire(5000);
+        EXPECT_NE(a, b);
+        EXPECT_EQ(6000U, workspace.get_size());
+        EXPECT_EQ(before + 6000, flbwt::mem_current());
+
+        // the smallest given back arena that fits is taken again
+        workspace.release(a);
+        workspace.release(b);
+        EXPECT_EQ(a, workspace.acquire(800));
+        EXPECT_EQ(b, workspace.acquire(1000));
+
+        // nothing fits --> new arena
+        void *c = workspace.acquire(100);
+        EXPECT_NE(a, c);
+        EXPECT_NE(b, c);
+        EXPECT_EQ(6100U, workspace.get_size());
+        EXPECT_EQ(before + 6100, flbwt::mem_current());
+
+        EXPECT_THROW(workspace.release((uint8_t *)a + 8), std::invalid_argument);
+    }
+
+    EXPECT_EQ(before, flbwt::mem_current());
+}
+
+TEST(workspace_test, carve_1)
+{
+    flbwt::Workspace workspace;
+    uint8_t *a = (uint8_t *)workspace.acquire(1000);
+    uint8_t *b = (uint8_t *)workspace.acquire(300);
+
+    // arenas in use are not carved
+    EXPECT_FALSE(workspace.can_carve(8));
+    EXPECT_EQ(NULL, workspace.carve(8));
+
+    workspace.release(a);
+    workspace.release(b);
+    EXPECT_TRUE(workspace.can_carve(1000));
+    EXPECT_FALSE(workspace.can_carve(1001));
+
+    // pieces are 8-byte aligned and go to the fullest arena with room
+    uint8_t *p = (uint8_t *)workspace.carve(250);
+    EXPECT_TRUE(p >= b && p + 256 <= b + 300);
+    EXPECT_EQ(0U, (uintptr_t)p % 8);
+
+    uint8_t *q = (uint8_t *)workspace.carve(100);
+    EXPECT_TRUE(q >= a && q + 104 <= a + 1000);
+
+    uint8_t *r = (uint8_t *)workspace.carve(40);
+    EXPECT_TRUE(r >= b && r + 40 <= p);
+
+    // carved arenas are not acquired whole again
+    uint8_t *c = (uint8_t *)workspace.acquire(200);
+    EXPECT_NE(a, c);
+    EXPECT_NE(b, c);
+
+    for (uint64_t i = 0; i < 896; i++)
+        a[i] = i;
+    for (uint64_t i = 0; i < 104; i++)
+        q[i] = 255;
+    for (uint64_t i = 0; i < 896; i++)
+        EXPECT_EQ((uint8_t)i, a[i]);
+}
+
+TEST(workspace_test, detach_1)
+{
+    int64_t before = flbwt::mem_current();
+    uint8_t *buffer;
+
+    {
+        flbwt::Workspace workspace;
+        void *a = workspace.acquire(4000);
+        void *b = workspace.acquire(2000);
+        workspace.release(a);
+        workspace.release(b);
+
+        workspace.carve(16);
+        EXPECT_THROW(workspace.detach(b, 100), std::invalid_argument);
+
+        // only the requested part stays counted after the hand over
+        buffer = workspace.detach(workspace.acquire(3000), 3000);
+        EXPECT_EQ(a, buffer);
+        EXPECT_EQ(2000U, workspace.get_size());
+        EXPECT_EQ(before + 5000, flbwt::mem_current());
+    }
+
+    EXPECT_EQ(before + 3000, flbwt::mem_current());
+    delete[] buffer;
+    flbwt::mem_untrack(3000);
+    EXPECT_EQ(before, flbwt::mem_current());
+}